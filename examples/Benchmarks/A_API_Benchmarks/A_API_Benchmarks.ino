@@ -0,0 +1,57 @@
+/*This code times the Betweener library's own functions and prints
+   the results to the serial monitor, one line per function, as JSON
+   (see BetweenerBench.h for what the numbers mean).  The times are
+   in processor cycles: divide by 96 for microseconds at 96 MHz.
+
+   Nothing needs to be plugged in, but the CV outs do change while it
+   runs.  Save the output to a file to compare it with a later run,
+   using extras/bench/compare_bench.py, e.g. after changing the
+   library, to catch anything that got slower.
+
+   It runs once, when the serial monitor is opened (or after 4 seconds).
+   Press the Teensy's button to run it again.
+*/
+
+#include <Betweener.h>
+#include <BetweenerBench.h>
+
+Betweener b;
+BetweenerBench bench;
+
+void setup() {
+  b.begin();
+  while (!Serial && millis() < 4000) {}  //wait for the serial monitor
+  bench.begin("api");
+
+  //inputs
+  bench.run("readTriggers", [&]{ b.readTriggers(); });
+  bench.run("readCVs", [&]{ b.readCVs(); });
+  bench.run("readKnobs", [&]{ b.readKnobs(); });
+  bench.run("readUsbMIDI", [&]{ b.readUsbMIDI(); });
+  bench.run("readAllInputs", [&]{ b.readAllInputs(); });
+  bench.run("readCV", [&]{ BetweenerBench::keep(b.readCV(1)); });
+  bench.run("readCV<1>", [&]{ BetweenerBench::keep(b.readCV<1>()); });
+  bench.run("readCVRaw", [&]{ BetweenerBench::keep(b.readCVRaw(1)); });
+  bench.run("readKnob", [&]{ BetweenerBench::keep(b.readKnob(1)); });
+  bench.run("CVChanged", [&]{ BetweenerBench::keep(b.CVChanged(1)); });
+  bench.run("triggerRose", [&]{ BetweenerBench::keep(b.triggerRose(1)); });
+
+  Betweener::InputSnapshot snapshot;
+  bench.run("getInputs", [&]{ b.getInputs(snapshot); });
+
+  //outputs
+  int value = 0;
+  bench.run("writeCVOut", [&]{ b.writeCVOut(1, value); value = (value + 1) & 4095; });
+  bench.run("writeCVOut<1>", [&]{ b.writeCVOut<1>(value); value = (value + 1) & 4095; });
+  bench.run("MCP4922_write", [&]{ Betweener::MCP4922_write(DAC_CHIP_SELECT1, 0, value); });
+  bench.run("pulseCVOut", [&]{ b.pulseCVOut(4, 4095, 1000); });
+
+  //conversions
+  volatile int input = 517;
+  bench.run("CVtoMIDI", [&]{ BetweenerBench::keep(b.CVtoMIDI(input)); });
+  bench.run("MIDItoCV", [&]{ BetweenerBench::keep(b.MIDItoCV(input & 127)); });
+  bench.run("knobToCV", [&]{ BetweenerBench::keep(b.knobToCV(input)); });
+}
+
+void loop() {
+}
@@ -0,0 +1,70 @@
+/*This code times one pass of loop() for some typical Betweener
+   "patches", the same work the example sketches do, and prints the
+   results to the serial monitor as JSON lines (see BetweenerBench.h
+   for what the numbers mean).  The times are in processor cycles:
+   divide by 96 for microseconds at 96 MHz.
+
+   - cv_to_midi:  read the CVs, send each one as a MIDI CC when it
+     changes (like the B_CVin_to_USB_MIDI conversion example)
+   - midi_to_cv:  read USB MIDI, turn 4 CC values into 4 CV outs
+     (like F_USB_MIDI_CC_to_CV; the CC values are made up here, so no
+     computer has to send any)
+   - quad_lfo:  4 sine LFOs, amplitude from the CV ins and rate from
+     the knobs, out to the 4 CV outs (like Quad_LFO_Demo)
+
+   calls_per_sec is how many times a second loop() could run that
+   patch, if it did nothing else.  Save the output to compare it with
+   a later run, using extras/bench/compare_bench.py.
+*/
+
+#include <Betweener.h>
+#include <BetweenerBench.h>
+
+Betweener b;
+BetweenerBench bench;
+
+int lastMIDI[4] = {-1, -1, -1, -1};
+float phase[4] = {0, 0, 0, 0};
+
+void setup() {
+  b.begin();
+  while (!Serial && millis() < 4000) {}  //wait for the serial monitor
+  bench.begin("patches");
+
+  bench.run("patch_cv_to_midi", [&]{
+    b.readCVs();
+    int values[4] = {b.currentCV(1), b.currentCV(2), b.currentCV(3), b.currentCV(4)};
+    for (int i = 0; i < 4; i++) {
+      int midi = b.CVtoMIDI(values[i]);
+      if (midi != lastMIDI[i]) {
+        usbMIDI.sendControlChange(20 + i, midi, 1);
+        lastMIDI[i] = midi;
+      }
+    }
+  }, 200, 1);
+
+  int cc = 0;
+  bench.run("patch_midi_to_cv", [&]{
+    b.readUsbMIDI();
+    for (int i = 0; i < 4; i++) {
+      b.writeCVOut(i + 1, b.MIDItoCV((cc + 32 * i) & 127));
+    }
+    cc++;
+  }, 200, 1);
+
+  bench.run("patch_quad_lfo", [&]{
+    b.readCVs();
+    b.readKnobs();
+    int amplitude[4] = {b.currentCV(1), b.currentCV(2), b.currentCV(3), b.currentCV(4)};
+    int rate[4] = {b.currentKnob(1), b.currentKnob(2), b.currentKnob(3), b.currentKnob(4)};
+    for (int j = 0; j < 4; j++) {
+      phase[j] += 0.0001 + rate[j] * 0.00001;
+      if (phase[j] >= 1.0) phase[j] -= 1.0;
+      int ampl = 4095 - map(amplitude[j], 0, b.CVMax(), 0, 4095);
+      b.writeCVOut(j + 1, ampl * 0.5 * (1.0 + sin(TWO_PI * phase[j])));
+    }
+  }, 200, 1);
+}
+
+void loop() {
+}
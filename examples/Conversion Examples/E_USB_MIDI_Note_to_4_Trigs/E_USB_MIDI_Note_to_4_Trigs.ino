@@ -18,7 +18,7 @@
 
 Betweener b;
 
-//variable to set trigger length
+//variable to set trigger length, in milliseconds
 int trigTime1 = 15;
 int trigTime2 = 15;
 int trigTime3 = 15;
@@ -28,6 +28,7 @@ void setup() {
   b.begin();  //start the Betweener
   usbMIDI.setHandleNoteOn(OnNoteOn);  //tell USB MIDI what to look for when it sees a Note On signal
   pinMode(8, OUTPUT); // Set Betweener LED to an Output
+  b.setPulseLED(true); //light the LED while any trigger is high
 }
 
 
@@ -59,38 +60,27 @@ void OnNoteOn(byte channel, byte note, byte velocity) {
 }
 
 void trigOut(byte out) {  //Tells the Betweener how to write Trigger to the CV outputs
+  //pulseCVOut writes the CV HIGH (approx 5v) right away and lets a timer
+  //write it LOW (0v) again when the time is up, so no delay() is needed.
+  //Overlapping drum hits on different outputs no longer wait for each
+  //other, and USB MIDI keeps being read while the triggers are high.
+  //The time is given in microseconds, hence the * 1000.
   switch (out) {
 
     case 1:
-      b.writeCVOut(1, 4095); //write the CV HIGH (approx 5v)
-      digitalWrite(8, HIGH); //turn LED On when a Note On message is received
-      delay(trigTime1); //write the CV LOW (0v)
-      digitalWrite(8, LOW); //turn LED Off
-      b.writeCVOut(1, 0);
+      b.pulseCVOut(1, 4095, trigTime1 * 1000);
       break;
 
     case 2:
-      b.writeCVOut(2, 4095);
-      digitalWrite(8, HIGH); //turn LED On when a Note On message is received
-      delay(trigTime2);
-      digitalWrite(8, LOW); //turn LED Off
-      b.writeCVOut(2, 0);
+      b.pulseCVOut(2, 4095, trigTime2 * 1000);
       break;
 
     case 3:
-      b.writeCVOut(3, 4095);
-      digitalWrite(8, HIGH); //turn LED On when a Note On message is received
-      delay(trigTime3);
-      digitalWrite(8, LOW); //turn LED Off
-      b.writeCVOut(3, 0);
+      b.pulseCVOut(3, 4095, trigTime3 * 1000);
       break;
 
     case 4:
-      b.writeCVOut(4, 4095);
-      digitalWrite(8, HIGH); //turn LED On when a Note On message is received
-      delay(trigTime4);
-      digitalWrite(8, LOW); //turn LED Off
-      b.writeCVOut(4, 0);
+      b.pulseCVOut(4, 4095, trigTime4 * 1000);
       break;
 
     default:
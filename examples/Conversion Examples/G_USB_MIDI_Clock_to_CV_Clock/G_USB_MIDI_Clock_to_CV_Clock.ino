@@ -0,0 +1,43 @@
+///////////////////////////////////////////////////////////
+//USB_MIDI_Clock_to_CV_Clock
+//
+//This code follows MIDI clock from a DAW over USB and
+//turns it into clocks for a modular system:
+//  1 Sixteenth notes, with swing set by Knob 1
+//  2 Quarter notes
+//  3 Reset pulse when the DAW starts playing
+//  4 Run gate, high while the DAW is playing
+//
+//The clock edges come from a hardware timer, not from
+//loop(), so they stay steady even while the sketch is busy.
+///////////////////////////////////////////////////////////
+
+#include <Betweener.h>
+#include <BetweenerMIDIClock.h>
+
+Betweener b;
+BetweenerMIDIClock midiClock;
+
+int lastSwing = -1;
+
+void setup() {
+  b.begin();  //start the Betweener
+
+  midiClock.setClockOutput(1, 4, 1);  //4 pulses per beat
+  midiClock.setClockOutput(2, 1, 1);  //1 pulse per beat
+  midiClock.setResetOutput(3);
+  midiClock.setRunOutput(4);
+  midiClock.begin();  //starts the timer and listens to usbMIDI clock messages
+}
+
+
+void loop() {
+  usbMIDI.read(); // USB MIDI receive
+
+  //knob 1 sets the swing of the 16ths, from straight (50%) to 75%
+  int swing = map(b.readKnob(1), 0, 1023, 50, 75);
+  if (swing != lastSwing) {
+    midiClock.setClockOutput(1, 4, 1, swing);
+    lastSwing = swing;
+  }
+}
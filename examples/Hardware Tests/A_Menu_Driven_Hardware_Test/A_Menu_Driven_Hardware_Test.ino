@@ -134,10 +134,10 @@ void printKnobValues(){
     //now the current knob values are stored in the betweener object
     //and we access and print them:
     Serial.println("knob values:");
-    Serial.println(b.currentKnob1);
-    Serial.println(b.currentKnob2);
-    Serial.println(b.currentKnob3);
-    Serial.println(b.currentKnob4);
+    Serial.println(b.currentKnob(1));
+    Serial.println(b.currentKnob(2));
+    Serial.println(b.currentKnob(3));
+    Serial.println(b.currentKnob(4));
     */
 
     //second way performs a read of each channel only when we ask for it.
@@ -191,10 +191,10 @@ void printCVInputs(){
     //we can grab them and print them
 
     Serial.println("Current CV input values:");
-    Serial.println(b.currentCV1);
-    Serial.println(b.currentCV2);
-    Serial.println(b.currentCV3);
-    Serial.println(b.currentCV4);
+    Serial.println(b.currentCV(1));
+    Serial.println(b.currentCV(2));
+    Serial.println(b.currentCV(3));
+    Serial.println(b.currentCV(4));
     */
 
   //second way performs a read of each channel only when 
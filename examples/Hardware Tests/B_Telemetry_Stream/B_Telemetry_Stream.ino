@@ -0,0 +1,36 @@
+/*This code streams everything the Betweener reads and writes to
+   the computer as compact binary telemetry frames, 1000 times a
+   second, while passing CV in 1-4 through to CV out 1-4 scaled by
+   the knobs.
+
+   The Arduino serial monitor cannot show binary frames.  Instead,
+   close it and run the decoder from the library's extras folder:
+     python3 extras/telemetry/betweener_telemetry.py --port /dev/ttyACM0 --csv capture.csv
+   (use your own port name, e.g. COM5 on Windows).
+
+   The decoder reports any frames that had to be dropped, so you can
+   see whether the rate you chose is sustainable.
+*/
+
+#include <Betweener.h>
+#include <BetweenerTelemetry.h>
+
+Betweener b;
+BetweenerTelemetry telemetry(b);
+
+void setup() {
+  b.begin();
+  telemetry.begin(1000);  //frames per second
+}
+
+void loop() {
+  b.readAllInputs();
+
+  b.writeCVOut(1, (long)b.currentCV(1) * b.currentKnob(1) / 256);
+  b.writeCVOut(2, (long)b.currentCV(2) * b.currentKnob(2) / 256);
+  b.writeCVOut(3, (long)b.currentCV(3) * b.currentKnob(3) / 256);
+  b.writeCVOut(4, (long)b.currentCV(4) * b.currentKnob(4) / 256);
+
+  //sends any frames that are waiting, without ever blocking
+  telemetry.update();
+}
@@ -0,0 +1,52 @@
+/*This code reads the CV inputs with more resolution than the
+   library's default 10 bits, and prints what it reads along with
+   how long each read of all 4 CV inputs took.
+
+   Each ADC conversion is 12 bits, the ADC averages 4 conversions
+   in hardware for every reading, and the library adds up 4 readings
+   for every value, which together give 13 bit CV readings (0-8191).
+   The knobs do not need that, so they are left at 10 bits, which
+   keeps them fast.
+
+   Try changing the numbers in setup() and watch how the read time
+   and the noise in the last digits change.  Open the serial monitor
+   to see the printout.
+*/
+
+#include <Betweener.h>
+
+Betweener b;
+
+void setup() {
+  //these take effect straight away, so they can also go after begin(),
+  //or be changed later in loop()
+  b.setADCResolution(12);        //bits per conversion
+  b.setCVAcquisition(13, 4, 4);  //13 bit readings: 4 hardware averages, 4x oversampled
+  b.setKnobAcquisition(10);      //knobs stay at 10 bits
+  b.begin();
+}
+
+void loop() {
+  b.readCVs();
+  b.readKnobs();
+
+  Serial.print("CV in (0-");
+  Serial.print(b.CVMax());
+  Serial.print("): ");
+  Serial.print(b.currentCV(1));
+  Serial.print(" ");
+  Serial.print(b.currentCV(2));
+  Serial.print(" ");
+  Serial.print(b.currentCV(3));
+  Serial.print(" ");
+  Serial.print(b.currentCV(4));
+  Serial.print("   as MIDI: ");
+  Serial.print(b.CVtoMIDI(b.currentCV(1)));
+  Serial.print("   CV read took ");
+  Serial.print(b.CVReadMicros());
+  Serial.print(" us, knob read took ");
+  Serial.print(b.knobReadMicros());
+  Serial.println(" us");
+
+  delay(250);
+}
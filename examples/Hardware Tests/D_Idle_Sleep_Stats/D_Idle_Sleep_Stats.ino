@@ -0,0 +1,49 @@
+/*This code passes CV in 1-4 through to CV out 1-4, but lets the
+   Teensy sleep in between, waking up every 2 ms to read the inputs
+   again or right away when a trigger input changes.
+
+   Once a second it prints how much of the time the processor was
+   asleep and how quickly it woke up for triggers.  Send it some
+   triggers and watch the numbers.  Comment out the idle() line to
+   compare with a loop() that never sleeps: the readings of a steady
+   CV should also jump around a little less when it sleeps.
+
+   Open the serial monitor to see the printout.
+*/
+
+#include <Betweener.h>
+#include <BetweenerIdle.h>
+
+Betweener b;
+elapsedMillis sinceReport;
+
+void setup() {
+  b.begin();
+  BetweenerIdle::begin();  //wake on all four triggers
+}
+
+void loop() {
+  b.readAllInputs();
+
+  b.writeCVOut(1, b.currentCV(1) * 4);
+  b.writeCVOut(2, b.currentCV(2) * 4);
+  b.writeCVOut(3, b.currentCV(3) * 4);
+  b.writeCVOut(4, b.currentCV(4) * 4);
+
+  if (sinceReport >= 1000) {
+    sinceReport = 0;
+    Serial.print("asleep ");
+    Serial.print(BetweenerIdle::sleepFraction() * 100.0);
+    Serial.print("% of the time, ");
+    Serial.print(BetweenerIdle::eventWakeups());
+    Serial.print(" trigger wake-ups, latency ");
+    Serial.print(BetweenerIdle::wakeLatencyCycles() / (F_CPU / 1000000.0));
+    Serial.print(" us (worst ");
+    Serial.print(BetweenerIdle::wakeLatencyMaxCycles() / (F_CPU / 1000000.0));
+    Serial.print(" us), CV 1 reads ");
+    Serial.println(b.currentCV(1));
+    BetweenerIdle::resetStats();
+  }
+
+  BetweenerIdle::idle(2000);  //sleep for up to 2 ms
+}
@@ -0,0 +1,82 @@
+/*This code reports how much memory the Betweener library is using, with
+   the parts that are switched on in BetweenerConfig.h.
+
+   It sets the Betweener up and reads all the inputs that are built, the
+   way most sketches do, and then prints to the serial monitor:
+   - which parts are switched on
+   - the size of one Betweener object (its RAM), and how much of that the
+     smoothing and Bounce objects take
+   - the flash and RAM the whole sketch uses, from the Teensy's own
+     memory map
+   Switch parts off in BetweenerConfig.h, upload it again and compare.
+   extras/size/size_report.py builds it in every configuration for you
+   and prints the table.
+*/
+
+#include <Betweener.h>
+
+//extras/size/size_report.py first builds this sketch with this switch,
+//and expects the build to stop here.  If it does not, the -D switches
+//are not reaching the compiler, and the table would only show the same
+//sizes over and over.
+#ifdef BETWEENER_SIZE_REPORT_CANARY
+#error "BETWEENER_SIZE_REPORT_CANARY: the -D switches reach the compiler"
+#endif
+
+Betweener b;
+
+//where things end up, from the Teensy 3's linker script
+extern "C" char _etext[], _sdata[], _edata[], _ebss[];
+
+void printPart(const char *name, int on) {
+  Serial.print("  ");
+  Serial.print(name);
+  Serial.println(on ? ": on" : ": off");
+}
+
+void setup() {
+  b.begin();
+  b.readAllInputs();
+
+  while (!Serial && millis() < 3000) {}  //give the serial monitor a moment
+
+  Serial.println("Betweener parts:");
+  printPart("analog inputs", BETWEENER_USE_ANALOG_INPUTS);
+  printPart("legacy names", BETWEENER_USE_ANALOG_INPUTS && BETWEENER_USE_LEGACY_NAMES);
+  printPart("smoothing", BETWEENER_USE_SMOOTHING);
+  printPart("triggers", BETWEENER_USE_TRIGGERS);
+  printPart("Bounce", BETWEENER_USE_BOUNCE);
+  printPart("USB MIDI", BETWEENER_USE_USB_MIDI);
+#ifdef DODINMIDI
+  printPart("DIN MIDI", 1);
+#else
+  printPart("DIN MIDI", 0);
+#endif
+
+  Serial.print("one Betweener object: ");
+  Serial.print(sizeof(Betweener));
+  Serial.println(" bytes of RAM");
+#if BETWEENER_USE_SMOOTHING
+  Serial.print("  of which smoothing: ");
+  Serial.println(8 * sizeof(ResponsiveAnalogRead));
+#endif
+#if BETWEENER_USE_ANALOG_INPUTS && BETWEENER_USE_LEGACY_NAMES
+  Serial.print("  of which the names currentCV1...lastKnob4: ");
+  Serial.println(16 * sizeof(int *));  //each is a hidden pointer
+#endif
+#if BETWEENER_USE_BOUNCE
+  Serial.print("  of which Bounce: ");
+  Serial.println(4 * sizeof(Bounce));
+#endif
+
+  //flash holds the code and the starting values of the variables
+  Serial.print("whole sketch, flash: ");
+  Serial.print((unsigned long)(_etext + (_edata - _sdata)));
+  Serial.print(" bytes, RAM (variables): ");
+  Serial.print((unsigned long)(_ebss - _sdata));
+  Serial.println(" bytes");
+}
+
+void loop() {
+  b.readAllInputs();
+}
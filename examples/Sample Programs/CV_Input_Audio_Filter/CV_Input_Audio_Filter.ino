@@ -0,0 +1,81 @@
+/*This code samples the four Betweener CV inputs into the
+   Teensy Audio library with an AudioInputBetweenerCV object,
+   runs them through audio-rate processing, and sends the
+   result back out of the CV outputs.
+
+   CV in 1 -> slew (lowpass) -> CV out 1
+   CV in 2 -> peak/envelope follower -> CV out 2 (via the DC object)
+   CV in 3 -> CV out 3 unchanged
+   CV in 4 -> CV out 4 unchanged
+
+   Once a second the sketch prints what the input object costs:
+   blocks delivered and dropped, the interrupt's cycles per block,
+   and the share of the processor it uses.
+
+   Note: while the input object runs it owns the ADC, so this
+   sketch does not read the knobs or call readCVs().
+*/
+
+#include <Betweener.h>
+#include <BetweenerAudioInput.h>
+#include <BetweenerAudioOutput.h>
+
+#include <Audio.h>
+#include <Wire.h>
+#include <SPI.h>
+#include <SD.h>
+#include <SerialFlash.h>
+
+AudioInputBetweenerCV    cvIn;
+AudioFilterStateVariable slew1;
+AudioAnalyzePeak         peak2;
+AudioSynthWaveformDc     follower2;
+AudioOutputBetweenerCV   cvOut;
+AudioConnection          patchCord1(cvIn, 0, slew1, 0);
+AudioConnection          patchCord2(slew1, 0, cvOut, 0);
+AudioConnection          patchCord3(cvIn, 1, peak2, 0);
+AudioConnection          patchCord4(follower2, 0, cvOut, 1);
+AudioConnection          patchCord5(cvIn, 2, cvOut, 2);
+AudioConnection          patchCord6(cvIn, 3, cvOut, 3);
+
+Betweener b;
+
+elapsedMillis reportTimer;
+
+void setup() {
+  b.begin();
+  AudioMemory(24);
+
+  slew1.frequency(5);  //a 5 Hz lowpass makes a smooth slew limiter
+
+  cvOut.setSamplesPerWrite(16);
+  cvOut.begin();
+  cvIn.setDecimation(1);  //full 44.1 kHz; try 4 or 8 to see the load drop
+  cvIn.begin();
+}
+
+void loop() {
+  //a simple envelope follower: the peak level of CV in 2, refreshed
+  //whenever the analyzer has a new value
+  if (peak2.available()) {
+    follower2.amplitude(peak2.read(), 5);
+  }
+
+  if (reportTimer >= 1000) {
+    reportTimer = 0;
+    Serial.print("conversions/s: ");
+    Serial.print(cvIn.conversionsPerSecond());
+    Serial.print("  blocks: ");
+    Serial.print(cvIn.blocksDelivered());
+    Serial.print("  dropped: ");
+    Serial.print(cvIn.blocksDropped());
+    Serial.print("  isr cycles/block: ");
+    Serial.print(cvIn.isrCyclesLast());
+    Serial.print(" (max ");
+    Serial.print(cvIn.isrCyclesMax());
+    Serial.print(")  isr load %: ");
+    Serial.print(cvIn.cpuLoad());
+    Serial.print("  audio cpu %: ");
+    Serial.println(AudioProcessorUsage());
+  }
+}
@@ -0,0 +1,46 @@
+/*This code turns the Betweener into a four channel "USB DAC": a computer
+   streams 12-bit CV for all four outputs, and the Betweener plays it out
+   1000 samples a second, 64 samples (64 ms) behind, so that USB's uneven
+   timing never shows up on the outputs.
+
+   To try it, run the Python program in extras/stream on the computer, e.g.
+       python3 betweener_stream.py --port /dev/ttyACM0 --sine 0.5
+   which sends four slow sine waves, or
+       python3 betweener_stream.py --port /dev/ttyACM0 --csv automation.csv
+   to play columns of 0-4095 values exported from elsewhere.  It prints
+   how full the Betweener's buffer is and anything that arrived late.
+
+   Set Tools > USB Type to "Serial + MIDI".  If the computer can only send
+   MIDI, the same blocks can come as SysEx (betweener_stream.py --midi);
+   those are handed to the stream below.  Use one or the other, not both.
+
+   Trigger input 1 going high empties the buffer and holds the outputs,
+   e.g. to stop a stream that has run away.
+*/
+
+#include <Betweener.h>
+#include <BetweenerCVStream.h>
+
+Betweener b;
+BetweenerCVStream stream;
+
+void onSysEx(const uint8_t *data, uint16_t length, bool complete) {
+  if (complete) stream.handleSysEx(data, length);
+}
+
+void setup() {
+  Serial.begin(9600);  //the speed is ignored: USB serial always runs at full speed
+  b.begin();
+  stream.begin(1000, 64);
+  usbMIDI.setHandleSystemExclusive(onSysEx);
+}
+
+void loop() {
+  stream.update();
+  usbMIDI.read();
+
+  b.readTriggers();
+  if (b.triggerRose(1)) {
+    stream.reset();
+  }
+}
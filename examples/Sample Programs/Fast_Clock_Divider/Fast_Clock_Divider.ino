@@ -0,0 +1,60 @@
+/*This code is a clock divider that keeps up with very fast clocks.
+
+   A clock into trigger input 1 comes out of CV out 1 divided by 2, out 2
+   divided by 4, out 3 by 8 and out 4 by 16 (each output flips every 1,
+   2, 4 or 8 clocks).  A trigger into input 2 resets them all.
+
+   It uses the fast trigger front end (useFastTriggers), which reads all
+   four trigger pins in one go and debounces them together.  With the
+   normal (Bounce) trigger reading, each trigger is ignored for 5 ms after
+   an edge, so nothing faster than about 100 Hz gets through; here the
+   clock can go well into the audio range.  loop() does nothing but read
+   the triggers, so it goes round very quickly.
+
+   Once a second the serial monitor shows the clock rate it counted.
+*/
+
+#include <Betweener.h>
+
+Betweener b;
+
+uint8_t count = 0;  //clocks since the last reset
+unsigned long clocks = 0;
+elapsedMillis sinceReport;
+
+void writeOutputs() {
+  //out n is bit n of the count: a square wave at 1/2^(n+1) of the clock
+  b.writeCVOut<1>((count & 1) ? 4095 : 0);
+  b.writeCVOut<2>((count & 2) ? 4095 : 0);
+  b.writeCVOut<3>((count & 4) ? 4095 : 0);
+  b.writeCVOut<4>((count & 8) ? 4095 : 0);
+}
+
+void setup() {
+  b.begin();
+  //debounce every readTriggers(): an edge counts after 4 reads in a row agree
+  b.useFastTriggers(0);
+  writeOutputs();
+}
+
+void loop() {
+  b.readTriggers();
+
+  if (b.triggerRose<2>()) {
+    count = 0;
+    writeOutputs();
+  }
+  if (b.triggerRose<1>()) {
+    count++;
+    clocks++;
+    writeOutputs();
+  }
+
+  if (sinceReport >= 1000) {
+    sinceReport = 0;
+    Serial.print("clock: ");
+    Serial.print(clocks);
+    Serial.println(" Hz");
+    clocks = 0;
+  }
+}
@@ -0,0 +1,140 @@
+/*This code reads the Betweener Trigger inputs and creates
+   envelopes on the 4 outputs, like Quad_ADSR.  The difference is
+   that the envelopes go straight from the Teensy Audio library
+   into the CV outputs through an AudioOutputBetweenerCV object,
+   so loop() no longer has to poll RMS objects and write the DACs.
+   The Teensy Audio Shield is not required.
+
+   Knobs 1-4 set the attack, decay, sustain, and release.
+
+   CV inputs 1-4 attenuate the envelopes.
+*/
+
+
+//include the Betweener library, and its Audio library output object
+#include <Betweener.h>
+#include <BetweenerAudioOutput.h>
+
+#include <Audio.h>
+#include <Wire.h>
+#include <SPI.h>
+#include <SD.h>
+#include <SerialFlash.h>
+
+AudioSynthWaveformDc     dc1;
+AudioSynthWaveformDc     dc2;
+AudioSynthWaveformDc     dc3;
+AudioSynthWaveformDc     dc4;
+AudioEffectEnvelope      envelope1;
+AudioEffectEnvelope      envelope2;
+AudioEffectEnvelope      envelope3;
+AudioEffectEnvelope      envelope4;
+AudioOutputBetweenerCV   cvOut;
+AudioConnection          patchCord1(dc1, envelope1);
+AudioConnection          patchCord2(dc2, envelope2);
+AudioConnection          patchCord3(dc3, envelope3);
+AudioConnection          patchCord4(dc4, envelope4);
+AudioConnection          patchCord5(envelope1, 0, cvOut, 0); //envelope 1 -> CV out 1
+AudioConnection          patchCord6(envelope2, 0, cvOut, 1); //envelope 2 -> CV out 2
+AudioConnection          patchCord7(envelope3, 0, cvOut, 2); //envelope 3 -> CV out 3
+AudioConnection          patchCord8(envelope4, 0, cvOut, 3); //envelope 4 -> CV out 4
+
+
+//make a Betweener object. anytime you want to talk to the Betweener
+//using the library, you will start by using the name "b."
+Betweener b;
+
+
+void setup() {
+  //the Betweener begin function is necessary before it will do anything
+  b.begin();
+
+  //for the audio tool stuff
+  AudioMemory(20); //needed for Audio Library
+
+  //write the CV outs about 2750 times a second, using the average of
+  //each group of 16 samples.  This must come after b.begin().
+  cvOut.setSamplesPerWrite(16);
+  cvOut.setMode(BETWEENER_CV_AVERAGE);
+  cvOut.begin();
+
+  //since the envelope is really a VCA with envelope controls, there must
+  //be a steady voltage applied to the input.  Its output level is now
+  //sent directly to the CV outs.
+  dc1.amplitude(1);
+  dc2.amplitude(1);
+  dc3.amplitude(1);
+  dc4.amplitude(1);
+}
+
+void loop() {
+  //this function reads just the triggers. Then we will check for certain conditions.
+  b.readTriggers();
+
+  // Check trigger for rising voltage/Note ON
+  if (b.triggerRose(1)) {
+    envelope1.noteOn();
+  }
+  if (b.triggerRose(2)) {
+    envelope2.noteOn();
+  }
+  if (b.triggerRose(3)) {
+    envelope3.noteOn();
+  }
+  if (b.triggerRose(4)) {
+    envelope4.noteOn();
+  }
+
+  // Check each trigger for a falling voltage/Note OFF
+  if (b.triggerFell(1)) {
+    envelope1.noteOff();  //Begin the release phase.
+  }
+  if (b.triggerFell(2)) {
+    envelope2.noteOff();
+  }
+  if (b.triggerFell(3)) {
+    envelope3.noteOff();
+  }
+  if (b.triggerFell(4)) {
+    envelope4.noteOff();
+  }
+
+  int attackVal = b.readKnob(1);
+  envelope1.attack(attackVal);
+  envelope2.attack(attackVal);
+  envelope3.attack(attackVal);
+  envelope4.attack(attackVal);
+
+  int decayVal = b.readKnob(2);
+  envelope1.decay(decayVal);
+  envelope2.decay(decayVal);
+  envelope3.decay(decayVal);
+  envelope4.decay(decayVal);
+
+  //scale the knob read from 0 - 1023 to 0.0 to 1.0 for the sustain level
+  float sustainLevel = mapFloat(b.readKnob(3), 0.0, 1023.0, 0.0, 1.0);
+  envelope1.sustain(sustainLevel);
+  envelope2.sustain(sustainLevel);
+  envelope3.sustain(sustainLevel);
+  envelope4.sustain(sustainLevel);
+
+  int releaseVal = b.readKnob(4);
+  envelope1.release(releaseVal);
+  envelope2.release(releaseVal);
+  envelope3.release(releaseVal);
+  envelope4.release(releaseVal);
+
+  //scale all envelopes based on an inversion of the voltage on
+  //the associated CV inputs. 0V = full scale, 5V = silent
+  dc1.amplitude(mapFloat(b.readCV(1), 0, 1023, 1.0, 0.));
+  dc2.amplitude(mapFloat(b.readCV(2), 0, 1023, 1.0, 0.));
+  dc3.amplitude(mapFloat(b.readCV(3), 0, 1023, 1.0, 0.));
+  dc4.amplitude(mapFloat(b.readCV(4), 0, 1023, 1.0, 0.));
+}
+
+
+//funtion for mapping float ranges
+float mapFloat(float x, float in_min, float in_max, float out_min, float out_max)
+{
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
@@ -0,0 +1,54 @@
+/*This code makes four different kinds of random voltage, one on each CV out:
+
+   - out 1: smooth random, gliding to a new voltage 0.2 to 20 times a
+     second (knob 1 sets how often)
+   - out 2: a Brownian "random walk" between 1V and 4V (knob 2 sets how
+     fast it may wander)
+   - out 3: random sample and hold, a new voltage each time trigger 1
+     goes high, between 0V and 2V
+   - out 4: white noise, kept small (about 1V) so it is usable as a
+     gentle random modulation
+
+   All of it is worked out by a timer 1000 times a second, so loop() only
+   has to look at the knobs.
+
+   The voltages come from a pseudo-random sequence with a fixed seed, so
+   the patch does exactly the same thing each time it is switched on.
+   Holding trigger 2 high while the Betweener starts up picks a new seed
+   from the noise on a CV input instead.
+*/
+
+#include <Betweener.h>
+#include <BetweenerRandom.h>
+
+Betweener b;
+BetweenerRandom rnd(12345);  //the seed
+
+void setup() {
+  b.begin();
+
+  b.readTriggers();
+  if (b.triggerHigh(2)) {
+    rnd.seed(b.readCVRaw(1) * micros());
+  }
+
+  rnd.setSmooth(1, 2.0);
+  rnd.setBrownian(2, 2000.0);  //at most 2000 DAC steps a second
+  rnd.setRange(2, 819, 3276);  //1V to 4V
+  rnd.setStepped(3, 1);
+  rnd.setRange(3, 0, 1638);    //0V to 2V
+  rnd.setWhite(4);
+  rnd.setRange(4, 1638, 2457); //around 2.5V, about 1V wide
+  rnd.begin();
+}
+
+void loop() {
+  b.readKnobs();
+  if (b.knobChanged(1)) {
+    //0.2 to 20 changes a second: each tenth of a turn multiplies the rate by the same amount
+    rnd.setSmooth(1, 0.2 * pow(100.0, b.currentKnob(1) / 1023.0));
+  }
+  if (b.knobChanged(2)) {
+    rnd.setBrownian(2, 100.0 + b.currentKnob(2) * 20.0);
+  }
+}
@@ -0,0 +1,96 @@
+/*This code records what you do with the CV inputs, knobs and triggers
+   to the SD card on the Teensy Audio shield, and plays it back out of
+   the CV outs.
+
+   - a trigger into trigger input 1 starts recording (to TAKE.REC on the
+     card, replacing what was there); another one stops it
+   - a trigger into trigger input 2 starts playing the recording back;
+     another one stops it.  CV in 1-4 come back out of CV out 1-4
+     (change the setOutput lines to play the knobs or triggers instead)
+
+   It records 1000 frames a second.  Open the serial monitor to see how
+   it is keeping up: "spare blocks" is how close it came to running out
+   of RAM while the card was busy (0 means very close), and "dropped"
+   or "late" frames mean it did run out, so try a lower rate.
+*/
+
+#include <Betweener.h>
+#include <BetweenerRecorder.h>
+#include <SD.h>
+
+#define SD_CHIP_SELECT 10  //the Audio shield's SD card
+
+Betweener b;
+BetweenerRecorder recorder(b);
+
+File file;
+BetweenerFileStorage<File> storage(file);
+
+elapsedMillis sinceReport;
+
+void setup() {
+  b.begin();
+  if (!SD.begin(SD_CHIP_SELECT)) {
+    Serial.println("no SD card found");
+  }
+  //CV out n plays CV in n (this is the default, shown here so it is
+  //easy to change)
+  recorder.setOutput(1, BETWEENER_RECORD_CV1);
+  recorder.setOutput(2, BETWEENER_RECORD_CV1 + 1);
+  recorder.setOutput(3, BETWEENER_RECORD_CV1 + 2);
+  recorder.setOutput(4, BETWEENER_RECORD_CV1 + 3);
+}
+
+void loop() {
+  b.readAllInputs();
+
+  if (b.triggerRose(1)) {
+    if (recorder.recording()) {
+      recorder.stop();
+      file.close();
+      Serial.println("recording stopped");
+    } else {
+      recorder.stop();
+      file.close();
+      SD.remove("TAKE.REC");
+      file = SD.open("TAKE.REC", FILE_WRITE);
+      recorder.record(storage, 1000);
+      Serial.println("recording");
+    }
+  }
+
+  if (b.triggerRose(2)) {
+    if (recorder.playing()) {
+      recorder.stop();
+      file.close();
+      Serial.println("playback stopped");
+    } else {
+      recorder.stop();
+      file.close();
+      file = SD.open("TAKE.REC");
+      if (recorder.play(storage)) {
+        Serial.println("playing");
+      }
+    }
+  }
+
+  //moves blocks between RAM and the card
+  recorder.update();
+
+  if (sinceReport >= 1000 && (recorder.recording() || recorder.playing())) {
+    sinceReport = 0;
+    Serial.print(recorder.frames());
+    Serial.print(" frames, ");
+    Serial.print(recorder.averageFrameBytes());
+    Serial.print(" bytes each, ");
+    Serial.print(recorder.bytesPerSecond());
+    Serial.print(" bytes/s, spare blocks ");
+    Serial.print(recorder.minFreeBlocks());
+    Serial.print(", slowest block ");
+    Serial.print(recorder.maxStorageMicros());
+    Serial.print(" us, dropped ");
+    Serial.print(recorder.framesDropped());
+    Serial.print(", late ");
+    Serial.println(recorder.underruns());
+  }
+}
@@ -0,0 +1,58 @@
+/*This code turns the Betweener into four sample and holds.
+
+   Each trigger input samples the CV input with the same number and
+   holds it on the CV out with the same number, a few microseconds
+   after the trigger arrives.  Outputs 1 and 2 are quantized to notes
+   (knob 1 picks the scale: chromatic, major, minor or pentatonic);
+   outputs 3 and 4 hold the voltage exactly as it was.
+
+   The sampling all happens inside interrupts, so loop() has nothing to
+   do except look at knob 1 and, once a second, print how long the
+   sampling took (from the trigger's interrupt starting to the DAC
+   having its new value) to the serial monitor.
+*/
+
+#include <Betweener.h>
+#include <BetweenerSampleHold.h>
+
+Betweener b;
+BetweenerSampleHold sh(b);
+
+const uint16_t scales[4] = {BETWEENER_SCALE_CHROMATIC, BETWEENER_SCALE_MAJOR,
+                            BETWEENER_SCALE_MINOR, BETWEENER_SCALE_PENTATONIC};
+
+elapsedMillis sinceReport;
+
+void setup() {
+  //12 bit conversions are plenty for notes and a little quicker than 16
+  //(it can be set before or after begin(), and changed at any time)
+  b.setADCResolution(12);
+  b.begin();
+  //(trigger, CV in, CV out, quantize?)
+  sh.attach(1, 1, 1, true);
+  sh.attach(2, 2, 2, true);
+  sh.attach(3, 3, 3);
+  sh.attach(4, 4, 4);
+}
+
+void loop() {
+  //knob 1 in four parts picks the scale
+  const int knob = b.readKnob(1);
+  sh.setScale(scales[knob * 4 / (b.knobMax() + 1)]);
+
+  if (sinceReport >= 1000) {
+    sinceReport = 0;
+    const float cyclesPerMicro = F_CPU / 1000000.0;
+    Serial.print("samples: ");
+    for (int t = 1; t <= 4; t++) {
+      Serial.print(sh.samples(t));
+      Serial.print(" ");
+    }
+    Serial.print(" latency us: last ");
+    Serial.print(sh.latencyCycles() / cyclesPerMicro);
+    Serial.print(" best ");
+    Serial.print(sh.latencyMinCycles() / cyclesPerMicro);
+    Serial.print(" worst ");
+    Serial.println(sh.latencyMaxCycles() / cyclesPerMicro);
+  }
+}
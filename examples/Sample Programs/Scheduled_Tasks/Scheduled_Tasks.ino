@@ -0,0 +1,57 @@
+/*This code shows how to run the parts of a sketch each at its own pace
+   with BetweenerScheduler, instead of doing everything on every loop().
+
+   - the triggers are read 1000 times a second, and a trigger into
+     input 1 flips CV out 2 between 0V and 5V
+   - CV in 1 is read 2000 times a second and sent to CV out 1, turned
+     down by knob 1 (a simple attenuator)
+   - the knobs are read only 100 times a second: hands are slow
+   - USB MIDI is read whenever there is nothing more urgent to do
+   - every 2 seconds the scheduler's table is printed to the serial
+     monitor: how often each task ran, how many deadlines it missed,
+     the longest it took, and how much of the processor it used
+*/
+
+#include <Betweener.h>
+#include <BetweenerScheduler.h>
+
+Betweener b;
+BetweenerScheduler sched;
+
+bool gateHigh = false;
+
+//these are our own tasks.  The scheduler hands each one the pointer we
+//gave addTask (we did not need one here, so it is NULL).
+void onTriggers(void *arg) {
+  if (b.triggerRose(1)) {
+    gateHigh = !gateHigh;
+    b.writeCVOut(2, gateHigh ? 4095 : 0);
+  }
+}
+
+void attenuate(void *arg) {
+  //both readings are 0-1023, the DAC wants 0-4095
+  const int out = b.currentCV(1) * b.currentKnob(1) / 256;
+  b.writeCVOut(1, constrain(out, 0, 4095));
+}
+
+void report(void *arg) {
+  sched.printStats(Serial);
+  Serial.println();
+}
+
+void setup() {
+  b.begin();
+  sched.addReadTriggers(b, 1000);
+  sched.addReadCVs(b, 500);
+  sched.addReadKnobs(b, 10000);
+  sched.addReadUsbMIDI(b);
+  //(function, pointer, period, deadline (0 = one period), priority, name)
+  sched.addTask(onTriggers, NULL, 1000, 0, 3, "gate");
+  sched.addTask(attenuate, NULL, 500, 0, 2, "attenuate");
+  sched.addTask(report, NULL, 2000000, 0, -1, "report");
+}
+
+void loop() {
+  sched.run();
+}
@@ -0,0 +1,76 @@
+/*A 16-step pitch/gate sequencer with a second modulation track,
+   run by the Betweener library's interrupt-driven sequencer.
+   Steps land on the outputs within microseconds of the clock,
+   no matter what loop() is doing.
+
+   Trigger 1: clock in (each rising edge is one step)
+   Trigger 2: reset in
+   CV out 1: pitch (track 1)
+   CV out 2: gate (track 1, follows the clock pulse width)
+   CV out 3: modulation CV (track 2, moves every 2nd clock)
+
+   Knob 1 chooses which step to edit.
+   Knob 2 sets that step's note (5 octaves).
+   Knob 3 sets that step's modulation value.
+   Trigger 3 toggles that step's gate.
+
+   Patterns can also be loaded over USB with SysEx messages;
+   see BetweenerSequencer.h for the format.
+*/
+
+#include <Betweener.h>
+#include <BetweenerSequencer.h>
+
+Betweener b;
+BetweenerSequencer seq;
+
+void setup() {
+  b.begin();
+
+  //track 1: pitch on out 1, gate on out 2, no CV
+  seq.setTrackOutputs(1, 1, 2, 0);
+  seq.setLength(1, 16);
+
+  //track 2: only CV, on out 3, half speed
+  seq.setTrackOutputs(2, 0, 0, 3);
+  seq.setLength(2, 16);
+  seq.setDivision(2, 2);
+
+  //a starting pattern: a rising arpeggio with every other gate on
+  for (int step = 0; step < 16; step++) {
+    seq.setStep(1, step, 24 + (step % 4) * 4, (step % 2) == 0, 0);
+    seq.setStep(2, step, 0, false, step * 256);
+  }
+
+  seq.clockFromTrigger(1);
+  seq.resetFromTrigger(2);
+  //or, with nothing patched into trigger 1:
+  //seq.clockInternal(120);
+
+  usbMIDI.setHandleSystemExclusive(OnSysEx);
+}
+
+void loop() {
+  usbMIDI.read();
+
+  //editing from the knobs.  Only write when a knob actually moved, so
+  //the step under edit is not constantly rewritten.
+  int step = map(b.readKnob(1), 0, 1023, 0, 15);
+  if (b.knobChanged(2)) {
+    seq.setNote(1, step, map(b.readKnob(2), 0, 1023, 0, 60));
+  }
+  if (b.knobChanged(3)) {
+    seq.setCV(2, step, b.readKnobCV(3));
+  }
+
+  b.readTriggers();
+  if (b.triggerRose(3)) {
+    seq.setGate(1, step, !seq.getGate(1, step));
+  }
+}
+
+void OnSysEx(const uint8_t *data, uint16_t length, bool complete) {
+  if (complete) {
+    seq.handleSysEx(data, length);
+  }
+}
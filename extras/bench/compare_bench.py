@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+#
+#  compare_bench.py
+#
+#  Compares two runs of the Betweener benchmarks: the JSON lines printed
+#  by the sketches in examples/Benchmarks (saved from the serial port) or
+#  by host_bench.cpp.  Lines that are not JSON, like anything else the
+#  sketch printed, are skipped.
+#
+#  Example:
+#      python3 compare_bench.py before.jsonl after.jsonl
+#
+#  For each benchmark in both runs it prints the mean and p99 per call,
+#  and how much the mean changed; --threshold flags changes larger than
+#  the given percentage (10 by default) and makes the exit status 1 if
+#  anything got slower by more than that.
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    results = {}
+    with open(path, encoding="utf-8", errors="replace") as f:
+        for line in f:
+            line = line.strip()
+            if not line.startswith("{"):
+                continue
+            try:
+                record = json.loads(line)
+            except ValueError:
+                continue
+            if "bench" in record:
+                results[record["bench"]] = record
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare two Betweener benchmark runs.")
+    parser.add_argument("before")
+    parser.add_argument("after")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="percent change to flag (default 10)")
+    args = parser.parse_args()
+
+    before = load(args.before)
+    after = load(args.after)
+    slower = False
+
+    print("%-28s %12s %12s %10s %10s %9s" % ("bench", "mean before", "mean after",
+                                            "p99 before", "p99 after", "change"))
+    for name in sorted(set(before) & set(after)):
+        b = before[name]
+        a = after[name]
+        if b["unit"] != a["unit"]:
+            print("%-28s units differ (%s vs %s), skipped" % (name, b["unit"], a["unit"]))
+            continue
+        change = 100.0 * (a["mean"] - b["mean"]) / b["mean"] if b["mean"] else 0.0
+        flag = ""
+        if abs(change) > args.threshold:
+            flag = "  SLOWER" if change > 0 else "  faster"
+            slower = slower or change > 0
+        print("%-28s %12.1f %12.1f %10d %10d %+8.1f%%%s" % (name, b["mean"], a["mean"],
+                                                         b["p99"], a["p99"], change, flag))
+
+    for name in sorted(set(before) ^ set(after)):
+        print("%-28s only in %s" % (name, args.before if name in before else args.after))
+
+    return 1 if slower else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
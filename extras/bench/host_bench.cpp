@@ -0,0 +1,75 @@
+//
+//  host_bench.cpp
+//
+//  Runs BetweenerBench (src/BetweenerBench.h) on a computer, on the parts
+//  of the library's work that are pure arithmetic: the reading/MIDI/CV
+//  conversions (the library's own, from src/BetweenerMath.h), the quad LFO calculation from the Quad_LFO_Demo example,
+//  the sequencer's step packing, the telemetry checksum and the random
+//  generators and voices of BetweenerRandom.  Nothing here
+//  touches Teensy hardware, so the same calculations can be timed before
+//  and after a change to see which version is faster.  The results are
+//  JSON lines in nanoseconds; they are only comparable with other runs on
+//  the same computer, not with the Teensy's cycle counts.
+//
+//  Build and run (from this folder):
+//      g++ -O2 -std=c++14 -I../../src host_bench.cpp -o host_bench
+//      ./host_bench > before.jsonl
+//  and after a change:
+//      ./host_bench > after.jsonl
+//      python3 compare_bench.py before.jsonl after.jsonl
+//
+
+#include <math.h>
+#include "BetweenerBench.h"
+#include "BetweenerMath.h"
+#include "BetweenerRandom.h"
+
+
+int main(void){
+    BetweenerBench bench;
+    bench.begin("host");
+
+    volatile int input = 517;  //volatile, so the compiler cannot work the answers out in advance
+
+    bench.run("CVtoMIDI", [&]{ BetweenerBench::keep(BetweenerMath::CVtoMIDI(input, 10)); }, 200, 100);
+    bench.run("MIDItoCV", [&]{ BetweenerBench::keep(BetweenerMath::MIDItoCV(input & 127)); }, 200, 100);
+    bench.run("knobToCV", [&]{ BetweenerBench::keep(BetweenerMath::knobToCV(input, 10)); }, 200, 100);
+    bench.run("seq_packStep", [&]{ BetweenerBench::keep(BetweenerMath::packStep(input % 61, true, input)); }, 200, 100);
+
+    uint8_t frame[33];
+    for (int i = 0; i < 33; i++) frame[i] = i * 7;
+    bench.run("telemetry_fletcher16", [&]{ BetweenerBench::keep(BetweenerMath::fletcher16(frame, frame + 33)); }, 200, 20);
+
+    //BetweenerRandom: the two generators, and one control tick of a
+    //smooth and a Brownian voice (the same seed every run)
+    BetweenerPCG32 pcg;
+    pcg.seed(1, 1);
+    BetweenerXorshift32 xorshift;
+    xorshift.seed(1, 1);
+    bench.run("random_pcg32", [&]{ BetweenerBench::keep(pcg.next()); }, 200, 100);
+    bench.run("random_xorshift32", [&]{ BetweenerBench::keep(xorshift.next()); }, 200, 100);
+    BetweenerRandomVoice smooth;
+    smooth.seed(1, 1);
+    smooth.setMode(BETWEENER_RANDOM_SMOOTH);
+    smooth.setSegmentTicks(250);
+    bench.run("random_voice_smooth", [&]{ BetweenerBench::keep(smooth.tick(false)); }, 200, 100);
+    BetweenerRandomVoice brownian;
+    brownian.seed(1, 2);
+    brownian.setMode(BETWEENER_RANDOM_BROWNIAN);
+    brownian.setMaxStep(20 << 16);
+    bench.run("random_voice_brownian", [&]{ BetweenerBench::keep(brownian.tick(false)); }, 200, 100);
+
+    //the per-output calculation of the Quad_LFO_Demo patch, for all 4 outputs
+    float phase[4] = {0, 0.1f, 0.2f, 0.3f};
+    const float step[4] = {0.001f, 0.002f, 0.0015f, 0.003f};
+    bench.run("patch_quad_lfo_math", [&]{
+        for (int j = 0; j < 4; j++){
+            phase[j] += step[j];
+            if (phase[j] >= 1.0f) phase[j] -= 1.0f;
+            const int ampl = 4095 - BetweenerMath::knobToCV(input, 10);
+            BetweenerBench::keep((int)(ampl * 0.5f * (1.0f + sinf(6.2831853f * phase[j]))));
+        }
+    }, 200, 20);
+
+    return 0;
+}
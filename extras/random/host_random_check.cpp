@@ -0,0 +1,110 @@
+//
+//  host_random_check.cpp
+//
+//  Checks on a computer that BetweenerRandom (src/BetweenerRandom.h) makes
+//  exactly the numbers it should, so a change to the generators or the
+//  voices cannot quietly change what a seeded sketch plays:
+//    - PCG32 and xorshift32 against their published reference sequences
+//    - one fixed run of a BetweenerRandomVoice in each mode, against the
+//      codes it made when this check was written
+//    - smooth and Brownian voices never leaving their range, over a long
+//      run with big steps
+//  It prints each check and exits with 1 if any of them failed, 0 if all
+//  passed.
+//
+//  Build and run (from this folder):
+//      g++ -O2 -std=c++14 -I../../src host_random_check.cpp -o host_random_check
+//      ./host_random_check
+//  and for the xorshift32 build of the voices:
+//      g++ -O2 -std=c++14 -DBETWEENER_RANDOM_XORSHIFT=1 -I../../src host_random_check.cpp -o host_random_check
+//
+
+#include <stdio.h>
+#include "BetweenerRandom.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char *what){
+    printf("%s  %s\n", ok ? "ok    " : "FAILED", what);
+    if (!ok) failures++;
+}
+
+//the codes 12 ticks of a voice make, seeded (7, stream), with the
+//settings below
+static bool voiceMatches(uint8_t mode, uint32_t stream, const uint16_t expected[12]){
+    BetweenerRandomVoice voice;
+    voice.seed(7, stream);
+    voice.setMode(mode);
+    voice.setSegmentTicks(5);
+    voice.setMaxStep(200 << 16);
+    for (int i = 0; i < 12; i++){
+        const uint16_t code = voice.tick(i % 3 == 0);  //stepped mode: a clock every third tick
+        if (code != expected[i]){
+            printf("        tick %d: got %u, expected %u\n", i, code, expected[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+//a long run with the range narrowed, checking every code
+static bool staysInRange(uint8_t mode, uint16_t low, uint16_t high){
+    BetweenerRandomVoice voice;
+    voice.seed(3, mode);
+    voice.setMode(mode);
+    voice.setRange(low, high);
+    voice.setSegmentTicks(7);
+    voice.setMaxStep(1500 << 16);  //bigger than the range, to exercise the bouncing
+    for (long i = 0; i < 1000000; i++){
+        const uint16_t code = voice.tick(false);
+        if (code < low || code > high){
+            printf("        tick %ld: %u is outside %u-%u\n", i, code, low, high);
+            return false;
+        }
+    }
+    return true;
+}
+
+
+int main(void){
+    //pcg32-demo from pcg-random.org: pcg32_srandom_r(&rng, 42, 54)
+    const uint32_t pcgExpected[6] = {0xa15c02b7, 0x7b47f409, 0xba1d3330,
+                                     0x83d2f293, 0xbfa4784b, 0xcbed606e};
+    BetweenerPCG32 pcg;
+    pcg.seed(42, 54);
+    bool pcgOk = true;
+    for (int i = 0; i < 6; i++) pcgOk = pcgOk && pcg.next() == pcgExpected[i];
+    check(pcgOk, "PCG32 seeded (42, 54) gives the reference sequence");
+
+    //Marsaglia's paper: xorshift32 from 2463534242 starts with 723471715
+    BetweenerXorshift32 xorshift;
+    const uint32_t xorshiftExpected[3] = {723471715UL, 2497366906UL, 2064144800UL};
+    bool xorshiftOk = true;
+    for (int i = 0; i < 3; i++) xorshiftOk = xorshiftOk && xorshift.next() == xorshiftExpected[i];
+    check(xorshiftOk, "xorshift32 from its default state gives the reference sequence");
+
+    //the voices use whichever generator BetweenerConfig.h picks
+#if BETWEENER_RANDOM_XORSHIFT
+    const uint16_t white[12] = {400, 248, 1862, 1056, 2462, 3090, 1814, 1067, 4005, 1137, 1812, 3452};
+    const uint16_t smooth[12] = {698, 1395, 2093, 2790, 3488, 3131, 2774, 2416, 2059, 1702, 2043, 2383};
+    const uint16_t brownian[12] = {89, 235, 408, 472, 625, 473, 525, 392, 384, 456, 535, 546};
+    const uint16_t stepped[12] = {541, 541, 541, 769, 769, 769, 1011, 1011, 1011, 3117, 3117, 3117};
+#else
+    const uint16_t white[12] = {2112, 300, 1864, 4001, 1724, 1688, 1616, 2471, 3904, 3303, 835, 3175};
+    const uint16_t smooth[12] = {485, 970, 1456, 1941, 2426, 2094, 1762, 1431, 1099, 767, 1106, 1445};
+    const uint16_t brownian[12] = {57, 46, 200, 19, 185, 190, 78, 97, 16, 35, 68, 4};
+    const uint16_t stepped[12] = {1830, 1830, 1830, 1776, 1776, 1776, 2254, 2254, 2254, 3672, 3672, 3672};
+#endif
+    check(voiceMatches(BETWEENER_RANDOM_WHITE, 1, white), "white voice makes the same codes");
+    check(voiceMatches(BETWEENER_RANDOM_SMOOTH, 2, smooth), "smooth voice makes the same codes");
+    check(voiceMatches(BETWEENER_RANDOM_BROWNIAN, 3, brownian), "Brownian voice makes the same codes");
+    check(voiceMatches(BETWEENER_RANDOM_STEPPED, 4, stepped), "stepped voice makes the same codes");
+
+    check(staysInRange(BETWEENER_RANDOM_SMOOTH, 1000, 3000), "smooth voice stays inside 1000-3000");
+    check(staysInRange(BETWEENER_RANDOM_BROWNIAN, 1000, 3000), "Brownian voice stays inside 1000-3000");
+    check(staysInRange(BETWEENER_RANDOM_BROWNIAN, 0, 4095), "Brownian voice stays inside 0-4095");
+    check(staysInRange(BETWEENER_RANDOM_BROWNIAN, 2000, 2000), "Brownian voice stays on a range of one code");
+
+    printf("%s\n", failures ? "some checks FAILED" : "all checks passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+#
+#  size_report.py
+#
+#  Builds a sketch once for each Betweener configuration (the switches in
+#  src/BetweenerConfig.h) and prints a table of the flash and RAM each one
+#  uses, and how much each saves compared with everything switched on.
+#
+#  It needs arduino-cli with the Teensy platform installed, and the
+#  arm-none-eabi-size tool that comes with it (found on the PATH or in
+#  the Arduino packages folder, or given with --size).  The switches are
+#  passed to the compiler with -D, so nothing gets edited.  The board is
+#  built with USB Type "Serial + MIDI" unless --fqbn says otherwise, since
+#  without MIDI the configurations that use usbMIDI cannot compile.
+#
+#  Example, from the library's folder:
+#      python3 extras/size/size_report.py
+#      python3 extras/size/size_report.py --sketch "examples/Sample Programs/Quad_LFO_Demo"
+#
+#  Before anything else it checks that the -D switches really reach the
+#  compiler: it builds E_Footprint_Report with BETWEENER_SIZE_REPORT_CANARY,
+#  which that sketch turns into an #error.  If that build succeeds, the
+#  build property (--property) is being ignored and the script stops,
+#  rather than printing a table of identical sizes.  For the same reason
+#  it also stops if "everything" and "CV outs only" come out the same.
+#
+#  The default sketch, examples/Hardware Tests/E_Footprint_Report, builds
+#  in every configuration.  Other sketches only build in the
+#  configurations that keep the parts they use; the others are reported
+#  as failed.
+
+import argparse
+import glob
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+LIBRARY = os.path.dirname(os.path.dirname(HERE))
+FOOTPRINT_SKETCH = os.path.join(LIBRARY, "examples", "Hardware Tests", "E_Footprint_Report")
+CANARY = "BETWEENER_SIZE_REPORT_CANARY"
+
+#name, and the -D switches that differ from "everything on"
+CONFIGURATIONS = [
+    ("everything", []),
+    ("no legacy names", ["BETWEENER_USE_LEGACY_NAMES=0"]),
+    ("no smoothing", ["BETWEENER_USE_SMOOTHING=0"]),
+    ("no Bounce (fast triggers)", ["BETWEENER_USE_BOUNCE=0"]),
+    ("no USB MIDI", ["BETWEENER_USE_USB_MIDI=0"]),
+    ("no triggers", ["BETWEENER_USE_TRIGGERS=0"]),
+    ("no analog inputs", ["BETWEENER_USE_ANALOG_INPUTS=0"]),
+    ("raw inputs, fast triggers", ["BETWEENER_USE_LEGACY_NAMES=0", "BETWEENER_USE_SMOOTHING=0",
+                                   "BETWEENER_USE_BOUNCE=0"]),
+    ("CV outs only", ["BETWEENER_USE_ANALOG_INPUTS=0", "BETWEENER_USE_TRIGGERS=0",
+                      "BETWEENER_USE_USB_MIDI=0"]),
+]
+
+
+def find_size_tool(given):
+    if given:
+        return given
+    tool = shutil.which("arm-none-eabi-size")
+    if tool:
+        return tool
+    for root in (os.path.expanduser("~/.arduino15"), os.path.expanduser("~/Library/Arduino15"),
+                 os.path.expanduser("~/AppData/Local/Arduino15")):
+        found = glob.glob(os.path.join(root, "packages", "*", "tools", "*", "*", "bin",
+                                       "arm-none-eabi-size*"))
+        if found:
+            return sorted(found)[-1]
+    sys.exit("could not find arm-none-eabi-size; give it with --size")
+
+
+def compile_sketch(args, sketch, defines, build_path):
+    flags = " ".join("-D" + d for d in defines)
+    command = [args.arduino_cli, "compile", "--fqbn", args.fqbn,
+               "--library", LIBRARY, "--build-path", build_path,
+               "--build-property", "%s=%s" % (args.property, flags),
+               sketch]
+    return subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                          universal_newlines=True)
+
+
+def check_flags_reach_compiler(args, build_path):
+    #the canary build has to fail, and with the canary's own #error
+    result = compile_sketch(args, FOOTPRINT_SKETCH, [CANARY], build_path)
+    if result.returncode != 0 and CANARY in result.stdout:
+        return
+    if args.verbose:
+        print(result.stdout, file=sys.stderr)
+    if result.returncode == 0:
+        sys.exit("the -D switches are not reaching the compiler: the build property %r is "
+                 "not used by this platform's compile recipes.  Look in its platform.txt for "
+                 "a property the recipes do use, and give it with --property." % args.property)
+    sys.exit("the check build of E_Footprint_Report failed for another reason; "
+             "run with --verbose to see the compiler output")
+
+
+def build(args, defines, build_path):
+    result = compile_sketch(args, args.sketch, defines, build_path)
+    if result.returncode != 0:
+        if args.verbose:
+            print(result.stdout, file=sys.stderr)
+        return None
+    elfs = glob.glob(os.path.join(build_path, "*.elf"))
+    return elfs[0] if elfs else None
+
+
+def measure(size_tool, elf):
+    #Berkeley format: text data bss dec hex filename.  Flash holds the code
+    #and the starting values of the variables; RAM holds the variables.
+    output = subprocess.run([size_tool, elf], stdout=subprocess.PIPE,
+                            universal_newlines=True, check=True).stdout
+    text, data, bss = (int(x) for x in output.splitlines()[1].split()[:3])
+    return text + data, data + bss
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Flash and RAM used by each Betweener configuration.")
+    parser.add_argument("--sketch", default=FOOTPRINT_SKETCH)
+    #USB Type "Serial + MIDI", so that the configurations with usbMIDI build
+    parser.add_argument("--fqbn", default="teensy:avr:teensy31:usb=serialmidi",
+                        help="board to build for (default: Teensy 3.1/3.2, USB Serial + MIDI)")
+    parser.add_argument("--arduino-cli", default="arduino-cli")
+    parser.add_argument("--size", help="path of arm-none-eabi-size")
+    parser.add_argument("--property", default="build.extra_flags",
+                        help="build property that adds compiler flags (default: build.extra_flags)")
+    parser.add_argument("--verbose", action="store_true", help="show the compiler output of failed builds")
+    args = parser.parse_args()
+
+    size_tool = find_size_tool(args.size)
+    rows = []
+    with tempfile.TemporaryDirectory() as scratch:
+        print("checking that -D switches reach the compiler", file=sys.stderr)
+        check_flags_reach_compiler(args, os.path.join(scratch, "canary"))
+        for n, (name, defines) in enumerate(CONFIGURATIONS):
+            print("building: %s" % name, file=sys.stderr)
+            elf = build(args, defines, os.path.join(scratch, str(n)))
+            rows.append((name, measure(size_tool, elf) if elf else None))
+
+    base = rows[0][1]
+    #with the inputs gone the sizes must drop; if not, the switches were lost
+    smallest = dict(rows).get("CV outs only")
+    if base and smallest and base == smallest:
+        sys.exit("\"everything\" and \"CV outs only\" came out the same size: the -D "
+                 "switches did not reach the compiler (try another --property)")
+    print("%-28s %10s %10s %10s %10s" % ("configuration", "flash", "saved", "RAM", "saved"))
+    for name, sizes in rows:
+        if sizes is None:
+            print("%-28s %10s" % (name, "failed"))
+            continue
+        flash, ram = sizes
+        if base:
+            print("%-28s %10d %10d %10d %10d" % (name, flash, base[0] - flash, ram, base[1] - ram))
+        else:
+            print("%-28s %10d %10s %10d %10s" % (name, flash, "", ram, ""))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
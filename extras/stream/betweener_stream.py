@@ -0,0 +1,251 @@
+#!/usr/bin/env python3
+#
+#  betweener_stream.py
+#
+#  Streams 12-bit CV for the four outputs to a Betweener running
+#  BetweenerCVStream (see src/BetweenerCVStream.h for the packet layout),
+#  and prints the status it sends back.
+#
+#  Examples:
+#      # four slow sine waves, a quarter cycle apart, at 0.5 Hz
+#      python3 betweener_stream.py --port /dev/ttyACM0 --sine 0.5
+#
+#      # play a CSV file of out1,out2,out3,out4 values (0-4095), one row
+#      # per sample, over and over
+#      python3 betweener_stream.py --port /dev/ttyACM0 --csv automation.csv --loop
+#
+#      # the same over MIDI SysEx, for when serial is not available
+#      python3 betweener_stream.py --midi "Teensy MIDI" --sine 0.5
+#
+#  The samples are sent just fast enough to keep the Betweener's buffer at
+#  about the latency set in the sketch: each status frame says where its
+#  playhead is, so the program never runs ahead of or behind the Teensy's
+#  own clock.  --rate and --latency must match the sketch's begin().
+#
+#  Serial needs pyserial (pip install pyserial); MIDI needs mido and
+#  python-rtmidi (pip install mido python-rtmidi).
+
+import argparse
+import csv
+import math
+import struct
+import sys
+import time
+
+SYNC = b"\xA5\x5A"
+BLOCK = 0x10
+STATUS = 0x11
+RESET = 0x12
+STATUS_SIZE = 41
+STATUS_PAYLOAD = struct.Struct("<HIHHB6I")
+MAX_FRAMES = 32
+SYSEX_ID = 0x7D
+SYSEX_CVSTREAM = 0x43
+
+STATUS_FIELDS = ("seq", "playhead", "fill", "min_fill", "free_slots", "accepted",
+                 "late_blocks", "late_samples", "underruns", "bad_packets", "overflows")
+
+
+def fletcher16(data):
+    sum1 = 0
+    sum2 = 0
+    for byte in data:
+        sum1 = (sum1 + byte) % 255
+        sum2 = (sum2 + sum1) % 255
+    return bytes((sum1, sum2))
+
+
+def packet(kind, payload):
+    body = bytes((kind, len(payload))) + payload
+    return SYNC + body + fletcher16(body)
+
+
+def block_packet(seq, timestamp, frames):
+    """frames is a list of (out1, out2, out3, out4), each 0-4095."""
+    data = bytearray()
+    for frame in frames:
+        for a, b in ((frame[0], frame[1]), (frame[2], frame[3])):
+            data += bytes((a & 0xFF, (a >> 8) | ((b & 0x0F) << 4), b >> 4))
+    header = struct.pack("<HIB", seq & 0xFFFF, timestamp & 0xFFFFFFFF, len(frames))
+    return packet(BLOCK, header + bytes(data))
+
+
+def block_sysex(seq, timestamp, frames):
+    """The same block as the data of a SysEx message (without F0/F7)."""
+    data = [SYSEX_ID, SYSEX_CVSTREAM, BLOCK, seq & 0x7F, (seq >> 7) & 0x7F]
+    data += [(timestamp >> (7 * i)) & 0x7F for i in range(5)]
+    data.append(len(frames))
+    for frame in frames:
+        for value in frame:
+            data += [value & 0x7F, value >> 7]
+    return data
+
+
+class StatusDecoder:
+    """Finds status frames in the bytes coming back from the Betweener."""
+
+    def __init__(self):
+        self.buffer = bytearray()
+
+    def feed(self, data):
+        self.buffer.extend(data)
+        while True:
+            start = self.buffer.find(SYNC)
+            if start < 0:
+                keep = 1 if self.buffer[-1:] == SYNC[:1] else 0
+                del self.buffer[:len(self.buffer) - keep]
+                return
+            del self.buffer[:start]
+            if len(self.buffer) < STATUS_SIZE:
+                return
+            frame = bytes(self.buffer[:STATUS_SIZE])
+            if (frame[2] != STATUS or frame[3] != STATUS_SIZE - 6
+                    or fletcher16(frame[2:-2]) != frame[-2:]):
+                del self.buffer[:1]
+                continue
+            del self.buffer[:STATUS_SIZE]
+            yield dict(zip(STATUS_FIELDS, STATUS_PAYLOAD.unpack(frame[4:-2])))
+
+
+def status_from_sysex(data):
+    """Decodes a status SysEx (data without F0/F7), or returns None."""
+    if len(data) != 3 + 2 * (STATUS_SIZE - 6) or list(data[:3]) != [SYSEX_ID, SYSEX_CVSTREAM, STATUS]:
+        return None
+    payload = bytes(data[3 + 2 * i] | (data[4 + 2 * i] << 4) for i in range(STATUS_SIZE - 6))
+    return dict(zip(STATUS_FIELDS, STATUS_PAYLOAD.unpack(payload)))
+
+
+def sine_source(hz, rate):
+    n = 0
+    while True:
+        yield tuple(int(2047.5 + 2047.5 * math.sin(2 * math.pi * (hz * n / rate + k / 4.0)))
+                    for k in range(4))
+        n += 1
+
+
+def csv_source(path, loop):
+    rows = []
+    with open(path) as f:
+        for row in csv.reader(f):
+            try:
+                values = [max(0, min(4095, int(float(v)))) for v in row[:4]]
+            except ValueError:
+                continue  # a header line
+            if values:
+                rows.append(tuple(values))
+    if not rows:
+        sys.exit("no samples in " + path)
+    while True:
+        for row in rows:
+            yield row + (0,) * (4 - len(row))
+        if not loop:
+            return
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    link = parser.add_mutually_exclusive_group(required=True)
+    link.add_argument("--port", help="serial port of the Betweener")
+    link.add_argument("--midi", help="MIDI port name of the Betweener (SysEx)")
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--sine", type=float, metavar="HZ", help="send four sine waves")
+    source.add_argument("--csv", help="send rows of out1,out2,out3,out4 from a file")
+    parser.add_argument("--loop", action="store_true", help="repeat the CSV file")
+    parser.add_argument("--rate", type=float, default=1000, help="samples per second (as in the sketch)")
+    parser.add_argument("--latency", type=int, default=64, help="samples of slack (as in the sketch)")
+    parser.add_argument("--block", type=int, default=MAX_FRAMES, help="samples per block, 1-32")
+    parser.add_argument("--seconds", type=float, help="stop after this long")
+    args = parser.parse_args()
+    args.block = max(1, min(MAX_FRAMES, args.block))
+
+    frames = sine_source(args.sine, args.rate) if args.sine is not None else csv_source(args.csv, args.loop)
+
+    if args.port:
+        import serial  # pyserial
+        port = serial.Serial(args.port, timeout=0)
+        decoder = StatusDecoder()
+
+        def send(seq, timestamp, block):
+            port.write(block_packet(seq, timestamp, block))
+
+        def statuses():
+            return list(decoder.feed(port.read(4096)))
+
+        port.write(packet(RESET, b""))
+    else:
+        import mido
+        out = mido.open_output(args.midi)
+        inp = mido.open_input(args.midi)
+
+        def send(seq, timestamp, block):
+            out.send(mido.Message("sysex", data=block_sysex(seq, timestamp, block)))
+
+        def statuses():
+            found = []
+            for message in inp.iter_pending():
+                if message.type == "sysex":
+                    status = status_from_sysex(message.data)
+                    if status:
+                        found.append(status)
+            return found
+
+        out.send(mido.Message("sysex", data=[SYSEX_ID, SYSEX_CVSTREAM, RESET]))
+
+    # the Betweener's playhead, as last reported, and when we heard it.
+    # Sample numbers are 32 bits on the Betweener and wrap around.
+    playhead = None
+    heard_at = 0.0
+    next_sample = 0
+    seq = 0
+    last_print = 0.0
+    status = None
+    started = time.time()
+    finished = False
+    try:
+        while not finished and (args.seconds is None or time.time() - started < args.seconds):
+            now = time.time()
+            for status in statuses():
+                # until our first block arrives, the playhead means nothing
+                if status["accepted"]:
+                    playhead = status["playhead"]
+                    heard_at = now
+
+            # where the playhead is now: before the first status, assume it
+            # starts 'latency' behind the first block, as the sketch does
+            if playhead is None:
+                ahead = args.latency
+            else:
+                ahead = ((next_sample - playhead + 2 ** 31) % 2 ** 32) - 2 ** 31
+                ahead -= (now - heard_at) * args.rate
+
+            # keep the buffer at the latency, plus one block in flight
+            while ahead < args.latency + args.block:
+                block = []
+                for frame in frames:
+                    block.append(frame)
+                    if len(block) == args.block:
+                        break
+                if not block:
+                    finished = True
+                    break
+                send(seq, next_sample, block)
+                seq += 1
+                next_sample = (next_sample + len(block)) & 0xFFFFFFFF
+                ahead += len(block)
+
+            if status and now - last_print >= 1.0:
+                last_print = now
+                print("fill %(fill)4d (lowest %(min_fill)4d)  accepted %(accepted)d  "
+                      "late blocks %(late_blocks)d  late samples %(late_samples)d  "
+                      "underruns %(underruns)d  bad %(bad_packets)d  lost %(overflows)d" % status)
+            time.sleep(0.002)
+    except KeyboardInterrupt:
+        pass
+
+    if status:
+        print("last status: " + ", ".join("%s %d" % (k, status[k]) for k in STATUS_FIELDS),
+              file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
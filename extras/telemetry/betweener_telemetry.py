@@ -0,0 +1,174 @@
+#!/usr/bin/env python3
+#
+#  betweener_telemetry.py
+#
+#  Records and decodes the binary telemetry stream sent by the
+#  BetweenerTelemetry class (see src/BetweenerTelemetry.h for the frame
+#  layout).
+#
+#  Examples:
+#      # show frames live from the Betweener
+#      python3 betweener_telemetry.py --port /dev/ttyACM0
+#
+#      # record the raw stream to a file while writing a CSV
+#      python3 betweener_telemetry.py --port /dev/ttyACM0 --raw take1.bin --csv take1.csv
+#
+#      # decode a raw recording afterwards
+#      python3 betweener_telemetry.py --file take1.bin --csv take1.csv
+#
+#  Reading from a serial port needs pyserial (pip install pyserial).
+#  Decoding files needs nothing beyond Python 3.
+
+import argparse
+import struct
+import sys
+
+SYNC = b"\xA5\x5A"
+FRAME_TYPE = 0x01
+FRAME_SIZE = 37
+PAYLOAD = struct.Struct("<HI8HB4H")  # seq, micros, 8 analog, triggers, 4 DAC
+
+CSV_HEADER = ("seq,micros,cv1,cv2,cv3,cv4,knob1,knob2,knob3,knob4,"
+              "trig1,trig2,trig3,trig4,out1,out2,out3,out4")
+
+
+def fletcher16(data):
+    sum1 = 0
+    sum2 = 0
+    for byte in data:
+        sum1 = (sum1 + byte) % 255
+        sum2 = (sum2 + sum1) % 255
+    return sum1, sum2
+
+
+class Decoder:
+    """Finds frames in a byte stream, checks them, and counts problems."""
+
+    def __init__(self):
+        self.buffer = bytearray()
+        self.frames = 0
+        self.bad_checksums = 0
+        self.skipped_bytes = 0
+        self.missing = 0
+        self.last_seq = None
+
+    def feed(self, data):
+        """Adds bytes and yields each complete, valid frame as a tuple."""
+        self.buffer.extend(data)
+        while True:
+            start = self.buffer.find(SYNC)
+            if start < 0:
+                # keep a trailing 0xA5 in case the 0x5A is still on its way
+                keep = 1 if self.buffer[-1:] == SYNC[:1] else 0
+                self.skipped_bytes += len(self.buffer) - keep
+                del self.buffer[:len(self.buffer) - keep]
+                return
+            if start > 0:
+                self.skipped_bytes += start
+                del self.buffer[:start]
+            if len(self.buffer) < FRAME_SIZE:
+                return
+            frame = bytes(self.buffer[:FRAME_SIZE])
+            if (frame[2] != FRAME_TYPE or frame[3] != FRAME_SIZE - 6
+                    or fletcher16(frame[2:35]) != (frame[35], frame[36])):
+                # not a real frame start; step past this sync and look again
+                self.bad_checksums += 1
+                self.skipped_bytes += 1
+                del self.buffer[:1]
+                continue
+            del self.buffer[:FRAME_SIZE]
+            values = PAYLOAD.unpack(frame[4:35])
+            seq = values[0]
+            if self.last_seq is not None:
+                self.missing += (seq - self.last_seq - 1) & 0xFFFF
+            self.last_seq = seq
+            self.frames += 1
+            yield values
+
+    def summary(self):
+        return ("%d frames, %d missing (dropped on the device), "
+                "%d bad checksums, %d bytes skipped"
+                % (self.frames, self.missing, self.bad_checksums, self.skipped_bytes))
+
+
+def to_csv(values):
+    seq, micros = values[0], values[1]
+    analog = values[2:10]
+    trig = values[10]
+    dac = values[11:15]
+    fields = [seq, micros]
+    fields += [-1 if a == 0xFFFF else a for a in analog]
+    fields += [(trig >> i) & 1 for i in range(4)]
+    fields += list(dac)
+    return ",".join(str(f) for f in fields)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--port", help="serial port of the Betweener")
+    source.add_argument("--file", help="raw recording to decode")
+    parser.add_argument("--raw", help="also save the raw bytes to this file")
+    parser.add_argument("--csv", help="write decoded frames to this CSV file")
+    parser.add_argument("--quiet", action="store_true", help="do not print frames")
+    parser.add_argument("--seconds", type=float, help="stop recording after this long")
+    args = parser.parse_args()
+
+    if args.port:
+        import serial  # pyserial
+        import time
+        stream = serial.Serial(args.port, timeout=0.1)
+        deadline = time.time() + args.seconds if args.seconds else None
+
+        def chunks():
+            while deadline is None or time.time() < deadline:
+                yield stream.read(4096)
+    else:
+        stream = open(args.file, "rb")
+
+        def chunks():
+            while True:
+                data = stream.read(65536)
+                if not data:
+                    return
+                yield data
+
+    raw = open(args.raw, "wb") if args.raw else None
+    csv = open(args.csv, "w") if args.csv else None
+    if csv:
+        csv.write(CSV_HEADER + "\n")
+
+    decoder = Decoder()
+    first_micros = None
+    last_micros = None
+    try:
+        for data in chunks():
+            if raw:
+                raw.write(data)
+            for values in decoder.feed(data):
+                if first_micros is None:
+                    first_micros = values[1]
+                last_micros = values[1]
+                line = to_csv(values)
+                if csv:
+                    csv.write(line + "\n")
+                if not args.quiet:
+                    print(line)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        stream.close()
+        if raw:
+            raw.close()
+        if csv:
+            csv.close()
+
+    print(decoder.summary(), file=sys.stderr)
+    if decoder.frames > 1 and last_micros != first_micros:
+        span = ((last_micros - first_micros) & 0xFFFFFFFF) / 1e6
+        print("%.1f frames/s over %.2f s" % ((decoder.frames - 1) / span, span),
+              file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
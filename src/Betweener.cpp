@@ -34,6 +34,45 @@
 //declared in Betweener.h, so we include it
 #include "Betweener.h"
 
+//static variables live in the class, not in any one object, so they are
+//created once here instead of in the constructor
+volatile uint16_t Betweener::CVOutValues[4] = {0, 0, 0, 0};
+uint8_t Betweener::adcAveraging = 4;  //the Teensy's own default
+#if BETWEENER_USE_BOUNCE
+constexpr Bounce Betweener::* Betweener::triggers[4];
+#endif
+
+
+//The trigger inputs as they are right now, bit 0 = trigger 1, set while
+//the trigger is high.  On the Teensy 3 this reads each GPIO port the
+//triggers are on just once (the V1 triggers are on ports A, B and D) and
+//picks the bits out with the board profile's table.  The profile is
+//known while compiling, so the loops fold away into those few reads.
+#if BETWEENER_USE_TRIGGERS
+#if defined(KINETISK)
+static volatile uint32_t * const gpioInputs[5] = {&GPIOA_PDIR, &GPIOB_PDIR, &GPIOC_PDIR, &GPIOD_PDIR, &GPIOE_PDIR};
+#endif
+
+static inline uint8_t sampleTriggerPins(void){
+    uint8_t high = 0;
+#if defined(KINETISK)
+    uint32_t ports[5] = {0, 0, 0, 0, 0};
+    for (int p = 0; p < 5; p++){
+        if (BetweenerBoards::usesTriggerPort(BETWEENER_BOARD, p)) ports[p] = *gpioInputs[p];
+    }
+    for (int i = 0; i < 4; i++){
+        //inverted by the hardware: a low pin is a high trigger
+        if (!(ports[BETWEENER_BOARD.triggerPorts[i]] & (1UL << BETWEENER_BOARD.triggerPortBits[i]))) high |= 1 << i;
+    }
+#else
+    for (int i = 0; i < 4; i++){
+        if (digitalReadFast(BETWEENER_BOARD.triggerPins[i]) == LOW) high |= 1 << i;
+    }
+#endif
+    return high;
+}
+#endif
+
 //Now, below, we have the code implementing all the functions
 //(a.k.a. methods) of the Betweener class.
 //The Betweener:: syntax specifies to the compiler that these
@@ -41,32 +80,32 @@
 //they will not conflict with other functions associated with
 //other classes that have similar names.
 
-Betweener::Betweener(void){
+//the name says which switches this copy of the library was built with
+const volatile uint8_t BETWEENER_CONFIG_CHECK = 0;
+
+
+void Betweener::init(void){
     //Constructor.  This code is run when you make a Betweener object.
     //We do not actually do much in this constructor.  For technical reasons
     //it is better to put all of the important stuff in a begin() function.
     
     //so... we just initialize some internal variables to nonsense values
     //so that they are not uninitialized.
-    currentCV1=-1;
-    currentCV2=-1;
-    currentCV3=-1;
-    currentCV4=-1;
-    
-    currentKnob1=-1;
-    currentKnob2=-1;
-    currentKnob3=-1;
-    currentKnob4=-1;
-
-    lastCV1=-1;
-    lastCV2=-1;
-    lastCV3=-1;
-    lastCV4=-1;
-    
-    lastKnob1=-1;
-    lastKnob2=-1;
-    lastKnob3=-1;
-    lastKnob4=-1;
+    for (int i = 0; i < 4; i++){
+        input.cv[i] = -1;
+        input.knob[i] = -1;
+        input.lastCV[i] = -1;
+        input.lastKnob[i] = -1;
+    }
+    input.triggers = 0;
+    input.triggersRose = 0;
+    input.triggersFell = 0;
+    input.sequence = 0;
+    input.cvMicros = 0;
+    input.knobMicros = 0;
+    input.triggerMicros = 0;
+    published[0] = input;
+    published[1] = input;
     
 }
     
@@ -92,56 +131,41 @@ void Betweener::begin(void){
     SPI.begin();
  
     
+#if BETWEENER_USE_TRIGGERS
     //Here, we tell Teensy what to do with trigger pins
-    pinMode(TRIGGER_INPUT1, INPUT_PULLUP);
-    pinMode(TRIGGER_INPUT2, INPUT_PULLUP);
-    pinMode(TRIGGER_INPUT3, INPUT_PULLUP);
-    pinMode(TRIGGER_INPUT4, INPUT_PULLUP);
-  
-    
-    // Create Bounce objects for each button.  The Bounce object
-    // automatically deals with contact chatter or "bounce", and
-    // it makes detecting changes very simple.
-        // Note that bounce_ms is set to a default in the .h file
-    trig1.attach(TRIGGER_INPUT1);
-    trig1.interval(bounce_ms);
-    
-    trig2.attach(TRIGGER_INPUT2);
-    trig2.interval(bounce_ms);
-    
-    trig3.attach(TRIGGER_INPUT3);
-    trig3.interval(bounce_ms);
-    
-    trig4.attach(TRIGGER_INPUT4);
-    trig4.interval(bounce_ms);
- 
+    //and create Bounce objects for each one.  The Bounce object
+    //automatically deals with contact chatter or "bounce", and
+    //it makes detecting changes very simple.
+    //Note that bounce_ms is set to a default in the .h file
+    for (int i = 0; i < 4; i++){
+        pinMode(BETWEENER_BOARD.triggerPins[i], INPUT_PULLUP);
+#if BETWEENER_USE_BOUNCE
+        (this->*triggers[i]).attach(BETWEENER_BOARD.triggerPins[i]);
+        (this->*triggers[i]).interval(bounce_ms);
+#endif
+    }
+    //start from the levels the inputs are at now, so nothing reads as an
+    //edge before the first change
+    input.triggers = sampleTriggerPins();
+#endif
 
+
+    //the ADC: bits per conversion, and the Teensy's default hardware
+    //averaging until the first read picks the group's own setting
+    analogReadRes(adcBits);
+    analogReadAveraging(4);
+    adcAveraging = 4;
+    
+#if BETWEENER_USE_SMOOTHING
     //set up the smoothed analog readout objects
     //this depends on our own modified version of the
     //responsiveAnalogRead library
-    smoothCV1.begin(CVIN1, RASleep, RASnapMultiplier);
-    smoothCV1.setActivityThreshold(RAActivityThreshold);
-    
-    smoothCV2.begin(CVIN2, RASleep, RASnapMultiplier);
-    smoothCV2.setActivityThreshold(RAActivityThreshold);
-    
-    smoothCV3.begin(CVIN3, RASleep, RASnapMultiplier);
-    smoothCV3.setActivityThreshold(RAActivityThreshold);
-    
-    smoothCV4.begin(CVIN4, RASleep, RASnapMultiplier);
-    smoothCV4.setActivityThreshold(RAActivityThreshold);
-    
-    smoothKnob1.begin(KNOB1, RASleep, RASnapMultiplier);
-    smoothKnob1.setActivityThreshold(RAActivityThreshold);
-  
-    smoothKnob2.begin(KNOB2, RASleep, RASnapMultiplier);
-    smoothKnob2.setActivityThreshold(RAActivityThreshold);
-    
-    smoothKnob3.begin(KNOB3, RASleep, RASnapMultiplier);
-    smoothKnob3.setActivityThreshold(RAActivityThreshold);
-    
-    smoothKnob4.begin(KNOB4, RASleep, RASnapMultiplier);
-    smoothKnob4.setActivityThreshold(RAActivityThreshold);
+    for (int i = 0; i < 4; i++){
+        smoothCV[i].begin(BETWEENER_BOARD.cvInPins[i], RASleep, RASnapMultiplier);
+        smoothKnob[i].begin(BETWEENER_BOARD.knobPins[i], RASleep, RASnapMultiplier);
+    }
+    setUpSmoothing();
+#endif
   
     
     //If we are using DIN MIDI I/O we need some setup:
@@ -154,65 +178,171 @@ void Betweener::begin(void){
 }
 
 
+#if BETWEENER_USE_TRIGGERS
 void Betweener::readTriggers(void){
+    updateTriggers();
+    publishInputs();
+}
+#endif
+
+
+#if BETWEENER_USE_ANALOG_INPUTS
+void Betweener::readCVs(void){
+    updateCVs();
+    publishInputs();
+}
+
+
+void Betweener::readKnobs(void){
+    updateKnobs();
+    publishInputs();
+}
+#endif
+
+
+//these three do the actual reading into our own copy of the inputs.  The
+//read functions above then publish it, and readAllInputs publishes once
+//after all three, so the snapshot has everything from the same pass.
+#if BETWEENER_USE_TRIGGERS
+void Betweener::useFastTriggers(uint32_t tickMicros){
+#if defined(KINETISK)
+    //the port table in the board profile has to match the pins.  The
+    //Teensy keeps each pin's configuration register at an address that
+    //gives away its port and bit, so check it against that.
+    for (int i = 0; i < 4; i++){
+        const uint32_t config = (uint32_t)portConfigRegister(BETWEENER_BOARD.triggerPins[i]);
+        if (config != 0x40049000UL + 0x1000UL * BETWEENER_BOARD.triggerPorts[i] + 4UL * BETWEENER_BOARD.triggerPortBits[i]){
+            DEBUG_PRINTLN("the board profile's trigger ports do not match its trigger pins!");
+#if BETWEENER_USE_BOUNCE
+            return;  //keep using Bounce
+#endif
+        }
+    }
+#endif
+    triggerTickMicros = tickMicros;
+    lastTriggerTick = micros();
+    triggerCount0 = 0xFF;
+    triggerCount1 = 0xFF;
+    fastTriggers = true;
+}
+
+
+void Betweener::updateFastTriggers(void){
+    const uint32_t now = micros();
+    uint8_t changed = 0;
+    if (triggerTickMicros == 0 || now - lastTriggerTick >= triggerTickMicros){
+        lastTriggerTick = now;
+        //The vertical counter.  For each input that reads differently from
+        //its debounced state the counter counts down (3, 2, 1, 0); the
+        //fourth time in a row it wraps round, and that input changes.  An
+        //input that reads the same as its state puts its counter back to 3.
+        const uint8_t differ = input.triggers ^ sampleTriggerPins();
+        triggerCount0 = ~(triggerCount0 & differ);
+        triggerCount1 = triggerCount0 ^ (triggerCount1 & differ);
+        changed = differ & triggerCount0 & triggerCount1;
+        input.triggers ^= changed;
+    }
+    input.triggersRose = changed & input.triggers;
+    input.triggersFell = changed & ~input.triggers;
+    input.triggerMicros = now;
+}
+
+
+void Betweener::updateTriggers(void){
+    if (fastTriggers){
+        updateFastTriggers();
+        return;
+    }
+#if BETWEENER_USE_BOUNCE
     //The bounce library has a function update() that is the
     //main read function
-    trig1.update();
-    trig2.update();
-    trig3.update();
-    trig4.update();
-    
+    uint8_t high = 0;
+    uint8_t rose = 0;
+    uint8_t fell = 0;
+    for (int i = 0; i < 4; i++){
+        Bounce &trig = this->*triggers[i];
+        trig.update();
+        //remember the trigger inputs are inverted by the hardware
+        if (trig.read() == LOW) high |= 1 << i;
+        if (trig.fell()) rose |= 1 << i;
+        if (trig.rose()) fell |= 1 << i;
+    }
+    input.triggers = high;
+    input.triggersRose = rose;
+    input.triggersFell = fell;
+    input.triggerMicros = micros();
+#endif
 }
+#endif
 
 
-void Betweener::readCVs(void){
+#if BETWEENER_USE_ANALOG_INPUTS
+void Betweener::updateCVs(void){
     //we could put stuff in here to limit the read
     //rate, but right now we'll leave that to the sketch
-    
-    lastCV1 = currentCV1;
-    lastCV2 = currentCV2;
-    lastCV3 = currentCV3;
-    lastCV4 = currentCV4;
-    
-    smoothCV1.update();
-    smoothCV2.update();
-    smoothCV3.update();
-    smoothCV4.update();
-  
-    currentCV1 = smoothCV1.getValue();
-    currentCV2 = smoothCV2.getValue();
-    currentCV3 = smoothCV3.getValue();
-    currentCV4 = smoothCV4.getValue();
-    
+    const uint32_t start = micros();
+    for (int i = 0; i < 4; i++){
+        readCVAt(i);
+    }
+    input.cvMicros = micros();
+    cvReadMicros = input.cvMicros - start;
 
 }
 
 
-void Betweener::readKnobs(void){
- 
-    lastKnob1=currentKnob1;
-    lastKnob2=currentKnob2;
-    lastKnob3=currentKnob3;
-    lastKnob4=currentKnob4;
-
-    smoothKnob1.update();
-    smoothKnob2.update();
-    smoothKnob3.update();
-    smoothKnob4.update();
-    
-    currentKnob1=smoothKnob1.getValue();
-    currentKnob2=smoothKnob2.getValue();
-    currentKnob3=smoothKnob3.getValue();
-    currentKnob4=smoothKnob4.getValue();
+void Betweener::updateKnobs(void){
+    const uint32_t start = micros();
+    for (int i = 0; i < 4; i++){
+        readKnobAt(i);
+    }
+    input.knobMicros = micros();
+    knobReadMicros_ = input.knobMicros - start;
     
 }
+#endif
+
+
+void Betweener::publishInputs(void){
+    //write the copy that is not the newest one...
+    const uint32_t count = snapshotCount + 1;
+    const int which = count & 1;
+    publishLock[which] = publishLock[which] + 1;  //odd: being written
+    __sync_synchronize();
+    input.sequence = count;
+    published[which] = input;
+    __sync_synchronize();
+    publishLock[which] = publishLock[which] + 1;  //even: finished
+    __sync_synchronize();
+    //...and then make it the newest
+    snapshotCount = count;
+}
+
+
+void Betweener::getInputs(InputSnapshot &copy){
+    //The copy we read is never the one publishInputs() is writing, unless
+    //the sketch managed to publish twice while we were copying.  That cannot
+    //happen from an interrupt (the sketch is paused while it runs), and only
+    //takes another try if it does, so this finishes in a bounded time.
+    for (;;){
+        const uint32_t count = snapshotCount;
+        const int which = count & 1;
+        const uint32_t lock = publishLock[which];
+        if (lock & 1) continue;  //caught it mid-write; look again
+        __sync_synchronize();
+        copy = published[which];
+        __sync_synchronize();
+        if (publishLock[which] == lock) return;
+    }
+}
 
+#if BETWEENER_USE_USB_MIDI
 void Betweener::readUsbMIDI(void) {
     //with each read, the usbMidi object
     //will store whatever messages it most recently received
     usbMIDI.read();
     
 }
+#endif
 
 
 #ifdef DODINMIDI
@@ -223,153 +353,88 @@ void Betweener::readDINMIDI(void){
 
 
 void Betweener::readAllInputs(void){
-    //run the previous four functions all in sequence
-    readTriggers();
-    readCVs();
-    readKnobs();
+    //run the previous four functions all in sequence (the ones that are
+    //built), and publish the new readings together
+#if BETWEENER_USE_TRIGGERS
+    updateTriggers();
+#endif
+#if BETWEENER_USE_ANALOG_INPUTS
+    updateCVs();
+    updateKnobs();
+#endif
+    publishInputs();
+#if BETWEENER_USE_USB_MIDI
     readUsbMIDI();
+#endif
 #ifdef DODINMIDI
     readDINMIDI();
 #endif
 }
 
 
-int Betweener::readCV(int channel){
-    int value = -1;
-    
-    switch (channel){
-        case 1:
-            lastCV1=currentCV1;
-            smoothCV1.update();
-            currentCV1 = smoothCV1.getValue();
-            value = currentCV1;
-            break;
-            
-        case 2:
-            lastCV2=currentCV2;
-            smoothCV2.update();
-            currentCV2 = smoothCV2.getValue();
-            value = currentCV2;
-            break;
-            
-        case 3:
-            lastCV3=currentCV3;
-            smoothCV3.update();
-            currentCV3=smoothCV3.getValue();
-            value = currentCV3;
-            break;
-            
-        case 4:
-            lastCV4=currentCV4;
-            smoothCV4.update();
-            currentCV4=smoothCV4.getValue();
-            value = currentCV4;
-            break;
-            
-        default:
-            DEBUG_PRINTLN("you are trying to read an nonexistent channel!");
-            break;
+//All of the functions below that take a channel number check it first,
+//and then use it (minus one) to look things up in the tables.
 
+#if BETWEENER_USE_ANALOG_INPUTS
+int Betweener::readCV(int channel){
+    if (channel < 1 || channel > 4){
+        BETWEENER_LOG(BETWEENER_LOG_BAD_CV_IN, channel);
+        return -1;
     }
+    const int value = readCVAt(channel - 1);
+    input.cvMicros = micros();
+    publishInputs();
     return value;
 }
 
 
 int Betweener::readKnob(int channel){
-    int value = -1;
-    
-    switch (channel){
-        case 1:
-            lastKnob1=currentKnob1;
-            smoothKnob1.update();
-            currentKnob1 = smoothKnob1.getValue();
-            value = currentKnob1;
-            break;
-            
-        case 2:
-            lastKnob2=currentKnob2;
-            smoothKnob2.update();
-            currentKnob2 = smoothKnob2.getValue();
-            value = currentKnob2;
-            break;
-            
-        case 3:
-            lastKnob3=currentKnob3;
-            smoothKnob3.update();
-            currentKnob3=smoothKnob3.getValue();
-            value = currentKnob3;
-            break;
-            
-        case 4:
-            lastKnob4=currentKnob4;
-            smoothKnob4.update();
-            currentKnob4=smoothKnob4.getValue();
-            value = currentKnob4;
-            break;
-            
-        default:
-            DEBUG_PRINTLN("you are trying to read an nonexistent channel!");
-            break;
-            
+    if (channel < 1 || channel > 4){
+        BETWEENER_LOG(BETWEENER_LOG_BAD_KNOB, channel);
+        return -1;
     }
+    const int value = readKnobAt(channel - 1);
+    input.knobMicros = micros();
+    publishInputs();
     return value;
 }
 
 
 
 int Betweener::readKnobRaw(int channel){
-    int value = -1;
-    switch (channel){
-        case 1:
-            value = analogRead(KNOB1);
-            break;
-            
-        case 2:
-            value = analogRead(KNOB2);
-            break;
-            
-        case 3:
-            value = analogRead(KNOB3);
-            break;
-            
-        case 4:
-            value = analogRead(KNOB4);
-            break;
-        default:
-            DEBUG_PRINTLN("you are trying to read an nonexistent channel!");
-            break;
-            
+    if (channel < 1 || channel > 4){
+        BETWEENER_LOG(BETWEENER_LOG_BAD_KNOB, channel);
+        return -1;
     }
-    return value;
+    return acquire(BETWEENER_BOARD.knobPins[channel - 1], knobAcq);
+}
+
+
+void Betweener::sampleInputsFromInterrupt(uint16_t values[8], uint8_t &triggers){
+    for (int i = 0; i < 8; i++) values[i] = 0;
+    triggers = 0;
+#if BETWEENER_USE_ANALOG_INPUTS
+    //if loop() was in the middle of an analogRead, the Teensy notices
+    //that we used the ADC and starts its reading again
+    const uint8_t theirs = adcAveraging;
+    for (int i = 0; i < 4; i++){
+        values[i] = acquire(BETWEENER_BOARD.cvInPins[i], cvAcq);
+        values[4 + i] = acquire(BETWEENER_BOARD.knobPins[i], knobAcq);
+    }
+    useAveraging(theirs);
+#endif
+#if BETWEENER_USE_TRIGGERS
+    triggers = sampleTriggerPins();
+#endif
 }
 
 
 int Betweener::readCVRaw(int channel){
-    int value = -1;
-    
-    switch (channel){
-        case 1:
-            value = analogRead(CVIN1);
-            break;
-            
-        case 2:
-            value = analogRead(CVIN2);
-            break;
-            
-        case 3:
-            value  = analogRead(CVIN3);
-            break;
-            
-        case 4:
-            value = analogRead(CVIN4);
-            break;
-            
-        default:
-            DEBUG_PRINTLN("you are trying to read an nonexistent channel!");
-            break;
-            
+    if (channel < 1 || channel > 4){
+        BETWEENER_LOG(BETWEENER_LOG_BAD_CV_IN, channel);
+        return -1;
     }
-    return value;
+    return acquire(BETWEENER_BOARD.cvInPins[channel - 1], cvAcq);
 }
 
 
@@ -378,34 +443,20 @@ bool Betweener::knobChanged(int knob){
     //currently relying on the built-in change function in the
     //responsiveAnalogRead library.
     //note this function INITIATES A READ
- 
-    bool changed = false;
-    switch(knob){
-        case 1:
-            smoothKnob1.update();
-            changed=smoothKnob1.hasChanged();
-            break;
-        case 2:
-            smoothKnob2.update();
-            changed=smoothKnob2.hasChanged();
-            break;
-        case 3:
-            smoothKnob3.update();
-            changed=smoothKnob3.hasChanged();
-            break;
-        case 4:
-            smoothKnob4.update();
-            changed=smoothKnob4.hasChanged();
-            break;
-        default:
-            DEBUG_PRINTLN("you are trying to read an nonexistent channel!");
-            //not sure whether to return true or false as default...
-            break;
-            
+    if (knob < 1 || knob > 4){
+        BETWEENER_LOG(BETWEENER_LOG_BAD_KNOB, knob);
+        //not sure whether to return true or false as default...
+        return false;
     }
-  
-    
-    return changed;
+#if BETWEENER_USE_SMOOTHING
+    smoothKnob[knob - 1].update(acquire(BETWEENER_BOARD.knobPins[knob - 1], knobAcq));
+    return smoothKnob[knob - 1].hasChanged();
+#else
+    //without the smoothing: has it moved further than the activity
+    //threshold (scaled up like the smoothing's) from the last readKnob()?
+    const int reading = acquire(BETWEENER_BOARD.knobPins[knob - 1], knobAcq);
+    return abs(reading - input.knob[knob - 1]) > (RAActivityThreshold << (knobAcq.bits - 10));
+#endif
     
 }
 
@@ -413,36 +464,99 @@ bool Betweener::knobChanged(int knob){
 bool Betweener::CVChanged(int cv_channel){
     //like the knob case, this function INITIATES A READ
     //and checks to see if the value is a new one
-    
-    bool changed = false;
-
-    switch(cv_channel){
-        case 1:
-            smoothCV1.update();
-            changed = smoothCV1.hasChanged();
-            break;
-        case 2:
-            smoothCV2.update();
-            changed = smoothCV2.hasChanged();
-            break;
-        case 3:
-            smoothCV3.update();
-            changed = smoothCV3.hasChanged();
-            break;
-        case 4:
-            smoothCV4.update();
-            changed = smoothCV4.hasChanged();
-            break;
-        default:
-            DEBUG_PRINTLN("you are trying to read an nonexistent channel!");
-            break;
-            
-    }
-    return changed;
+    if (cv_channel < 1 || cv_channel > 4){
+        BETWEENER_LOG(BETWEENER_LOG_BAD_CV_IN, cv_channel);
+        return false;
+    }
+#if BETWEENER_USE_SMOOTHING
+    smoothCV[cv_channel - 1].update(acquire(BETWEENER_BOARD.cvInPins[cv_channel - 1], cvAcq));
+    return smoothCV[cv_channel - 1].hasChanged();
+#else
+    const int reading = acquire(BETWEENER_BOARD.cvInPins[cv_channel - 1], cvAcq);
+    return abs(reading - input.cv[cv_channel - 1]) > (RAActivityThreshold << (cvAcq.bits - 10));
+#endif
 }
+#endif
+
+
 
+void Betweener::setADCResolution(int bits){
+    if (bits != 10 && bits != 12 && bits != 13 && bits != 16){
+        DEBUG_PRINTLN("the ADC resolution can be 10, 12, 13 or 16 bits");
+        return;
+    }
+    if (bits > BETWEENER_BOARD.adcBits){
+        DEBUG_PRINTLN("this board's ADC cannot convert that many bits");
+        return;
+    }
+    //change the ADC now too, in case begin() has already run.  Interrupts
+    //are off so a sample and hold trigger never sees the new bits with
+    //the old conversions, or the other way round.
+    __disable_irq();
+    adcBits = bits;
+    analogReadRes(bits);
+    __enable_irq();
+    //the groups' shifts depend on the conversion bits, so work them out again
+    setAcquisition(cvAcq, cvAcq.bits, cvAcq.hardwareAveraging, 1 << cvAcq.oversampleShift);
+    setAcquisition(knobAcq, knobAcq.bits, knobAcq.hardwareAveraging, 1 << knobAcq.oversampleShift);
+}
+
+
+void Betweener::setCVAcquisition(int bits, int hardwareAveraging, int oversample){
+    if (setAcquisition(cvAcq, bits, hardwareAveraging, oversample)) setUpSmoothing();
+}
+
+
+void Betweener::setKnobAcquisition(int bits, int hardwareAveraging, int oversample){
+    if (setAcquisition(knobAcq, bits, hardwareAveraging, oversample)) setUpSmoothing();
+}
+
+
+bool Betweener::setAcquisition(Acquisition &a, int bits, int hardwareAveraging, int oversample){
+    if (hardwareAveraging != 1 && hardwareAveraging != 4 && hardwareAveraging != 8
+        && hardwareAveraging != 16 && hardwareAveraging != 32){
+        DEBUG_PRINTLN("hardware averaging can be 1, 4, 8, 16 or 32");
+        return false;
+    }
+    int shift = 0;
+    while ((1 << shift) < oversample && shift < 4) shift++;
+    if ((1 << shift) != oversample){
+        DEBUG_PRINTLN("oversample can be 1, 2, 4, 8 or 16");
+        return false;
+    }
+    //every 4 times oversampled is worth one more bit
+    const int mostBits = min(adcBits + shift / 2, 16);
+    if (bits < 10 || bits > mostBits){
+        DEBUG_PRINT("with these settings the readings can have 10 to ");
+        DEBUG_PRINT(mostBits);
+        DEBUG_PRINTLN(" bits; using the most");
+        bits = constrain(bits, 10, mostBits);
+    }
+    a.bits = bits;
+    a.hardwareAveraging = hardwareAveraging;
+    a.oversampleShift = shift;
+    //the sum of 2^shift conversions has adcBits + shift bits; keep the top 'bits'
+    a.resultShift = adcBits + shift - bits;
+    return true;
+}
+
+
+void Betweener::setUpSmoothing(void){
+    //the smoothing needs to know the range of the readings, and its
+    //activity threshold (given for 10 bit readings) has to grow with it
+#if BETWEENER_USE_SMOOTHING
+    for (int i = 0; i < 4; i++){
+        smoothCV[i].setAnalogResolution(1 << cvAcq.bits);
+        smoothCV[i].setActivityThreshold(RAActivityThreshold << (cvAcq.bits - 10));
+        smoothKnob[i].setAnalogResolution(1 << knobAcq.bits);
+        smoothKnob[i].setActivityThreshold(RAActivityThreshold << (knobAcq.bits - 10));
+    }
+#endif
+}
 
 
+
+#if BETWEENER_USE_ANALOG_INPUTS
 int Betweener::readCVInputMIDI(int channel){
     return CVtoMIDI(readCV(channel));
 
@@ -457,13 +571,13 @@ int Betweener::readKnobMIDI(int channel){
 int Betweener::readKnobCV(int channel){
     return knobToCV(readKnob(channel));
 }
+#endif
     
 int Betweener::CVtoMIDI(int val){
-    //CV inputs are 10 bit (range 0-1023)
+    //CV inputs are 10 bit (range 0-1023) unless set otherwise
     //midi CC values go from 0 to 127, 7 bit
     //so we can get that by simply bit shifting
-    int midival = val >>3;
-    return midival;
+    return BetweenerMath::CVtoMIDI(val, cvAcq.bits);
     
 }
 
@@ -471,200 +585,234 @@ int Betweener::CVtoMIDI(int val){
 int Betweener::MIDItoCV(int val){
     //midi CC values go from 0 to 127
     //CV outs are 12 bit (range 0-4095)
-    int cvval = map(val, 0, 127, 0, 4095);
-    return cvval;
+    return BetweenerMath::MIDItoCV(val);
     
 }
 
 
 int Betweener::knobToMIDI(int val){
-    //knob inputs are 10 bit (range 0-1023)
+    //knob inputs are 10 bit (range 0-1023) unless set otherwise
     //midi CC values go from 0 to 127, 7 bit
     //so we can get that by simply bit shifting
-    int midival = val >> 3;
-    return midival;
+    return BetweenerMath::CVtoMIDI(val, knobAcq.bits);
     
 }
 
 int Betweener::knobToCV(int val){
-    //knob inputs are 10 bit (range 0-1023)
+    //knob inputs are 10 bit (range 0-1023) unless set otherwise
     //CV outs are 12 bit (range 0-4095)
-    int cvval = map(val,0,1023,0,4095);
-    return cvval;
+    return BetweenerMath::knobToCV(val, knobAcq.bits);
 }
 
 
 
+#if BETWEENER_USE_TRIGGERS
 bool Betweener::triggerRose(int trigger){
     //note:  because of hardware setup, a rising trigger input is read as a
-    //falling value at the Teensy pin, and vice versa
+    //falling value at the Teensy pin; updateTriggers has already turned
+    //the bits the right way up
     //also note!  you must call readTriggers() first
-    bool rose = false;
-    switch(trigger){
-        case 1:
-            rose = trig1.fell();
-            break;
-        case 2:
-            rose = trig2.fell();
-            break;
-        case 3:
-            rose = trig3.fell();
-            break;
-        case 4:
-            rose = trig4.fell();
-            break;
-        default:
-            DEBUG_PRINTLN("you are trying to read an nonexistent trigger!");
-            break;
-            
-    }
-    return rose;
+    if (trigger < 1 || trigger > 4){
+        BETWEENER_LOG(BETWEENER_LOG_BAD_TRIGGER, trigger);
+        return false;
+    }
+    return input.triggersRose & (1 << (trigger - 1));
 }
 
 
 bool Betweener::triggerFell(int trigger){
     //note:  because of hardware setup, a rising trigger input is read as a
-    //falling value at the Teensy pin, and vice versa
+    //falling value at the Teensy pin; updateTriggers has already turned
+    //the bits the right way up
     //also note!  you must call readTriggers() first
-    bool fell = false;
-    switch(trigger){
-        case 1:
-            fell = trig1.rose();
-            break;
-        case 2:
-            fell = trig2.rose();
-            break;
-        case 3:
-            fell = trig3.rose();
-            break;
-        case 4:
-            fell = trig4.rose();
-            break;
-        default:
-            DEBUG_PRINTLN("you are trying to read an nonexistent trigger!");
-            break;
-            
-    }
-    return fell;
+    if (trigger < 1 || trigger > 4){
+        BETWEENER_LOG(BETWEENER_LOG_BAD_TRIGGER, trigger);
+        return false;
+    }
+    return input.triggersFell & (1 << (trigger - 1));
 }
 
 
 bool Betweener::triggerHigh(int trigger){
-    //note:  because of hardware setup, a high input trigger
-    //is read as a low at the Teensy pin and vice versa
+    //note:  because of hardware setup, a high input trigger is read as a
+    //low at the Teensy pin; updateTriggers has already turned the bits
+    //the right way up
     //also note!  you must call readTriggers() first
-    int value = 0;
-
-    switch(trigger){
-        case 1:
-            value = trig1.read();
-            break;
-        case 2:
-            value = trig2.read();
-            break;
-        case 3:
-            value = trig3.read();
-            break;
-        case 4:
-            value = trig4.read();
-            break;
-        default:
-            DEBUG_PRINTLN("you are trying to read an nonexistent trigger!");
-            break;
-            
-    }
-    //here's where the logic is reversed due to the high/low switch
-    if (value == HIGH){
+    if (trigger < 1 || trigger > 4){
+        BETWEENER_LOG(BETWEENER_LOG_BAD_TRIGGER, trigger);
         return false;
-    }else{
-        return true;
     }
-
+    return input.triggers & (1 << (trigger - 1));
 }
 
 
 bool Betweener::triggerLow(int trigger){
-    //note:  because of hardware setup, a high input trigger
-    //is read as a low at the Teensy pin and vice versa
+    //note:  because of hardware setup, a high input trigger is read as a
+    //low at the Teensy pin; updateTriggers has already turned the bits
+    //the right way up
     //also note!  you must call readTriggers() first
-    int value = 0;
-    
-    switch(trigger){
-        case 1:
-            value = trig1.read();
-            break;
-        case 2:
-            value = trig2.read();
-            break;
-        case 3:
-            value = trig3.read();
-            break;
-        case 4:
-            value = trig4.read();
-            break;
-        default:
-            DEBUG_PRINTLN("you are trying to read an nonexistent trigger!");
-            break;
-            
-    }
-    //here's where the logic is reversed due to the high/low switch
-    if (value == LOW){
+    if (trigger < 1 || trigger > 4){
+        BETWEENER_LOG(BETWEENER_LOG_BAD_TRIGGER, trigger);
         return false;
-    }else{
-        return true;
     }
-    
+    return !(input.triggers & (1 << (trigger - 1)));
 }
+#endif
 
 
-void Betweener::MCP4922_write(int cs_pin, byte dac, int value){
-    // Adapted from code by Sebastian Tomczak
-    // from a tutorial here:  http://little-scale.blogspot.com/2016/11/teensy-and-mcp4922-dual-channel-12-bit.html
+//(MCP4922_write is in Betweener.h, so the template writeCVOut can use it)
 
-    byte low = value & 0xff;
-    byte high = (value >> 8) & 0x0f;
-    dac = (dac & 1) << 7;
-    digitalWrite(cs_pin, LOW);
-    //Using beginTransaction and endTransaction to allow for the use of audio shield at the
-    //same time.  The settings here are for SPI communication with the chip, which
-    //works with the default mode 0 and with byte order MSB first.  I am unsure of the
-    //best clock speed choice so this might be something to tweak if it becomes buggy
-    SPI.beginTransaction(SPISettings(4000000,MSBFIRST,SPI_MODE0));
-    SPI.transfer(dac | 0x30 | high);
-    SPI.transfer(low);
-    SPI.endTransaction();
-    digitalWrite(cs_pin, HIGH);
+
+void Betweener::shareDACWithInterrupt(IRQ_NUMBER_t irq){
+    //the SPI library keeps a list of interrupts to mask during each transaction
+    SPI.usingInterrupt(irq);
+}
+
+
+void Betweener::shareDACWithTimers(void){
+    //IntervalTimer does not tell us which hardware timer channel it picked,
+    //so we register all of them.  A DAC write only takes a few microseconds,
+    //so holding off the other timers for that long is harmless.
+#if defined(KINETISK)
+    SPI.usingInterrupt(IRQ_PIT_CH0);
+    SPI.usingInterrupt(IRQ_PIT_CH1);
+    SPI.usingInterrupt(IRQ_PIT_CH2);
+    SPI.usingInterrupt(IRQ_PIT_CH3);
+#elif defined(__IMXRT1062__)
+    SPI.usingInterrupt(IRQ_PIT);
+#endif
+}
+
+
+void Betweener::shareDACWithPin(uint8_t pin){
+    SPI.usingInterrupt(pin);
 }
 
 
 void Betweener::writeCVOut(int cvout, int value){
-    int cs_pin = -1;
-    byte dac = -1;
-    switch (cvout){
-        case 1:
-            cs_pin = CVOUT1_CHIP_SELECT;
-            dac = CVOUT1_DAC_CHANNEL;
-            break;
-        case 2:
-            cs_pin = CVOUT2_CHIP_SELECT;
-            dac = CVOUT2_DAC_CHANNEL;
-            break;
-        case 3:
-            cs_pin = CVOUT3_CHIP_SELECT;
-            dac = CVOUT3_DAC_CHANNEL;
-            break;
-        case 4:
-            cs_pin = CVOUT4_CHIP_SELECT;
-            dac=CVOUT4_DAC_CHANNEL;
-            break;
-        default:
-            DEBUG_PRINTLN("you are trying to write to a nonexistent CV channel!");
-            break;
-       
+    if (cvout < 1 || cvout > 4){
+        BETWEENER_LOG(BETWEENER_LOG_BAD_CV_OUT, cvout);
+        return;
     }
     
     //should put in some idiot checks here that the value is reasonable...
     
-    MCP4922_write(cs_pin, dac,value);
+    //store the value inside the same SPI transaction as the write (see
+    //writeCVOut<> in Betweener.h)
+    SPI.beginTransaction(SPISettings(BETWEENER_BOARD.dacSPIClock,MSBFIRST,SPI_MODE0));
+    MCP4922_send(BETWEENER_BOARD.cvOutChipSelect[cvout - 1], BETWEENER_BOARD.cvOutDACChannel[cvout - 1], value);
+    CVOutValues[cvout - 1] = value;
+    SPI.endTransaction();
+}
+
+
+int Betweener::currentCVOut(int cvout){
+    if (cvout < 1 || cvout > 4){
+        BETWEENER_LOG(BETWEENER_LOG_BAD_CV_OUT, cvout);
+        return -1;
+    }
+    return CVOutValues[cvout - 1];
+}
+
+
+////////////////////////////////////////////////////////////////////////
+//Timed pulses.
+//
+//Each CV out has at most one pulse in flight, so the "queue" is just four
+//end times.  One IntervalTimer is always set to go off at the earliest of
+//them; when it does, it ends every pulse that is due and re-arms itself
+//for the next one.  Starting, retriggering and ending a pulse therefore
+//each take the same small, fixed amount of work.
+
+static IntervalTimer pulseTimer;
+static volatile uint32_t pulseEnd[4];       //micros() value when each pulse ends
+static volatile uint16_t pulseRest[4];      //the level to go back to
+static volatile uint8_t pulseActiveMask = 0; //bit n set while out n+1 is pulsing
+static bool pulseLED = false;
+static bool pulseSetUp = false;
+
+static void pulseTimerISR(void);
+
+//(re)arms the timer for the earliest pending pulse end, or stops it.
+//Must be called with interrupts off, or from the timer itself.
+static void pulseArm(uint32_t now){
+    if (pulseActiveMask == 0){
+        pulseTimer.end();
+        if (pulseLED) digitalWrite(BETWEENER_LED, LOW);
+        return;
+    }
+    int32_t soonest = 0x7FFFFFFF;
+    for (int i = 0; i < 4; i++){
+        if (pulseActiveMask & (1 << i)){
+            int32_t remaining = (int32_t)(pulseEnd[i] - now);
+            if (remaining < soonest) soonest = remaining;
+        }
+    }
+    //the timer cannot go off sooner than a couple of microseconds
+    if (soonest < 2) soonest = 2;
+    pulseTimer.begin(pulseTimerISR, (unsigned int)soonest);
+}
+
+
+static void pulseTimerISR(void){
+    const uint32_t now = micros();
+    for (int i = 0; i < 4; i++){
+        if ((pulseActiveMask & (1 << i)) && (int32_t)(pulseEnd[i] - now) <= 0){
+            Betweener::writeCVOut(i + 1, pulseRest[i]);
+            pulseActiveMask &= ~(1 << i);
+        }
+    }
+    pulseArm(now);
+}
+
+
+void Betweener::pulseCVOut(int cvout, int level, unsigned long duration_us, int restLevel){
+    if (cvout < 1 || cvout > 4){
+        BETWEENER_LOG(BETWEENER_LOG_BAD_CV_OUT, cvout);
+        return;
+    }
+    if (!pulseSetUp){
+        //the timer writes the DACs, so SPI has to know about it
+        shareDACWithTimers();
+        pulseSetUp = true;
+    }
+    const int i = cvout - 1;
+
+    //the end time is worked out as a signed 32-bit difference, so longer
+    //than about 35 minutes would look like the past
+    if (duration_us > 0x7FFFFFFFUL) duration_us = 0x7FFFFFFFUL;
+
+    //a pulse already running on this output must not end (and write its
+    //rest level over the new one) while the new level is going out, so
+    //take it off the timer's list first
+    __disable_irq();
+    pulseActiveMask &= ~(1 << i);
+    __enable_irq();
+
+    //the new level goes out right away
+    writeCVOut(cvout, level);
+
+    //then record when it should end.  Interrupts are off for just these
+    //few lines so the timer never sees a half-updated entry.  (micros()
+    //switches interrupts back on itself, so it is read first.)
+    const uint32_t now = micros();
+    __disable_irq();
+    pulseEnd[i] = now + duration_us;
+    pulseRest[i] = restLevel;
+    pulseActiveMask |= (1 << i);
+    if (pulseLED) digitalWrite(BETWEENER_LED, HIGH);
+    pulseArm(now);
+    __enable_irq();
 }
 
+
+bool Betweener::pulseActive(int cvout){
+    if (cvout < 1 || cvout > 4) return false;
+    return (pulseActiveMask >> (cvout - 1)) & 1;
+}
+
+
+void Betweener::setPulseLED(bool mirror){
+    pulseLED = mirror;
+    if (mirror) pinMode(BETWEENER_LED, OUTPUT);
+}
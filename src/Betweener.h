@@ -61,79 +61,89 @@
 
 //Here is where we include all the other Arduino libraries that this
 //depends on.  We're using the updated "Bounce2" library because it
-//is more compatible with being used in other libraries
+//is more compatible with being used in other libraries.
+//BetweenerConfig.h says which parts of the library are built, and so
+//which of these are needed at all.
 #include <Arduino.h>
 #include <SPI.h>
+#include "BetweenerConfig.h"
+#if BETWEENER_USE_BOUNCE
 #include <Bounce2.h>
+#endif
+#ifdef DODINMIDI
 #include <MIDI.h>
+#endif
+#if BETWEENER_USE_SMOOTHING
 #include <ResponsiveAnalogRead.h>
+#endif
+#include "BetweenerLog.h"
+#include "BetweenerMath.h"  //the scaling sums, also built on a computer
 
 
 //This is where we define hard-wired pin associations.
-//These are "preprocessor directive" statements (with # symbol) instead of
-//variable definitions.  We use uppercase names in order to make it
+//The actual numbers live in a "board profile" table in BetweenerBoards.h,
+//one table per version of the hardware.  The names below are
+//"preprocessor directive" statements (with # symbol) instead of
+//variable definitions, which just look the numbers up in that table.
+//We use uppercase names in order to make it
 //easy to tell that these are not normal variables when we invoke them in the
 //code.  The difference is that #define statements are only implemented when
 //the code is compiled, and never when the code is just being run.
 //That makes it impossible for any of the code to actively change these
 //parameters while it is running, which is a good idea since the
 //definitions relate to hard-wired configuration choices.
+#include "BetweenerBoards.h"
 
 //SPI is a communication protocol used for the digital-analog-converters (DACs)
 //in the device.  These are used to create the CV outputs.
 //SPI communication requires two pins for special functions,
 //called MOSI and SCK.
-#define SPI_MOSI 7 // note this is technically the "alternate" MOSI option for Teensy
-#define SPI_SCK 14
+#define SPI_MOSI (BETWEENER_BOARD.spiMOSI) // note this is technically the "alternate" MOSI option for Teensy
+#define SPI_SCK (BETWEENER_BOARD.spiSCK)
 //Also for the SPI protocol, these parameters are used to select
 //which DAC we are sending messages to
-#define DAC_CHIP_SELECT1 1
-#define DAC_CHIP_SELECT2 2
+#define DAC_CHIP_SELECT1 (BETWEENER_BOARD.dacChipSelects[0])
+#define DAC_CHIP_SELECT2 (BETWEENER_BOARD.dacChipSelects[1])
 //Identify the 4 CV outs with the right chip and DAC.
 //This is something that may change for different board versions.
-#define CVOUT1_CHIP_SELECT 2
-#define CVOUT1_DAC_CHANNEL 1
-#define CVOUT2_CHIP_SELECT 1
-#define CVOUT2_DAC_CHANNEL 0
-#define CVOUT3_CHIP_SELECT 2
-#define CVOUT3_DAC_CHANNEL 0
-#define CVOUT4_CHIP_SELECT 1
-#define CVOUT4_DAC_CHANNEL 1
+#define CVOUT1_CHIP_SELECT (BETWEENER_BOARD.cvOutChipSelect[0])
+#define CVOUT1_DAC_CHANNEL (BETWEENER_BOARD.cvOutDACChannel[0])
+#define CVOUT2_CHIP_SELECT (BETWEENER_BOARD.cvOutChipSelect[1])
+#define CVOUT2_DAC_CHANNEL (BETWEENER_BOARD.cvOutDACChannel[1])
+#define CVOUT3_CHIP_SELECT (BETWEENER_BOARD.cvOutChipSelect[2])
+#define CVOUT3_DAC_CHANNEL (BETWEENER_BOARD.cvOutDACChannel[2])
+#define CVOUT4_CHIP_SELECT (BETWEENER_BOARD.cvOutChipSelect[3])
+#define CVOUT4_DAC_CHANNEL (BETWEENER_BOARD.cvOutDACChannel[3])
 
 //Other pins used for inputs (which may change for different board versions)
 //digital pins used for trigger inputs
-#define TRIGGER_INPUT1 0
-#define TRIGGER_INPUT2 3
-#define TRIGGER_INPUT3 5
-#define TRIGGER_INPUT4 4
+#define TRIGGER_INPUT1 (BETWEENER_BOARD.triggerPins[0])
+#define TRIGGER_INPUT2 (BETWEENER_BOARD.triggerPins[1])
+#define TRIGGER_INPUT3 (BETWEENER_BOARD.triggerPins[2])
+#define TRIGGER_INPUT4 (BETWEENER_BOARD.triggerPins[3])
 //analog inputs used for the 4 CV inputs
-#define CVIN1 A7
-#define CVIN2 A6
-#define CVIN3 A3
-#define CVIN4 A2
+#define CVIN1 (BETWEENER_BOARD.cvInPins[0])
+#define CVIN2 (BETWEENER_BOARD.cvInPins[1])
+#define CVIN3 (BETWEENER_BOARD.cvInPins[2])
+#define CVIN4 (BETWEENER_BOARD.cvInPins[3])
 //analog inputs used for the 4 potentiometers/knobs
-#define KNOB1 A12
-#define KNOB2 A13
-#define KNOB3 A11
-#define KNOB4 A10
+#define KNOB1 (BETWEENER_BOARD.knobPins[0])
+#define KNOB2 (BETWEENER_BOARD.knobPins[1])
+#define KNOB3 (BETWEENER_BOARD.knobPins[2])
+#define KNOB4 (BETWEENER_BOARD.knobPins[3])
+//the LED on the front panel
+#define BETWEENER_LED (BETWEENER_BOARD.led)
 
 
-//use this flag to decide whether to make use of DIN midi or not
-//If you want it, uncomment the line in the code that says #define DODINMIDI.
-//Otherwise, leave it commented it out.
-//Note that if you use MIDI DIN, you will need
-//the updated MIDI library for Teensy, from here:
-//https://github.com/FortySevenEffects/arduino_midi_library
-//and you will need to delete the default MIDI.h file that
-//is included in the Arduino package.
-//#define DODINMIDI
+//whether to make use of DIN midi or not is decided by the DODINMIDI
+//line in BetweenerConfig.h, together with the other parts you can leave out
 
 
 //If we do choose to use hardware MIDI, these will be
 //the pins.  Alternate pins for Serial2.  See:
 //https://www.pjrc.com/teensy/td_uart.html
-#define DINMIDIIN 26
-#define DINMIDIOUT 31
+#define DINMIDIIN (BETWEENER_BOARD.dinMIDIIn)
+#define DINMIDIOUT (BETWEENER_BOARD.dinMIDIOut)
 
 
 //If you want the code to give you some error messages in the
@@ -141,15 +151,28 @@
 #define DEBUG  //leave this line in to have automatic error printouts to Serial monitor
 //this little "preprocessor macro" (which is like a function but processed at a different time)
 //will be used to print the debug info.  See examples in the .cpp file for how this gets used.
+//DEBUG_PRINT prints right away, so it is only used in setup-type functions.
+//Functions that run all the time (or inside interrupts) use BETWEENER_LOG
+//instead, which just records the error for BetweenerLog::flush() to print
+//later.  See BetweenerLog.h.
 #ifdef DEBUG
 #define DEBUG_PRINT(...) Serial.print(__VA_ARGS__)
 #define DEBUG_PRINTLN(...) Serial.println(__VA_ARGS__)
+#define BETWEENER_LOG(code, value) BetweenerLog::record((code), (value))
 #else
 #define DEBUG_PRINT(...)
 #define DEBUG_PRINTLN(...)
+#define BETWEENER_LOG(code, value)
 #endif
 
 
+//defined in Betweener.cpp under a name made of the switches the library was
+//built with (see BetweenerConfig.h).  The constructor below reads it, so a
+//sketch built with different switches fails to link instead of running
+//with a Betweener object laid out differently from the library's.
+extern const volatile uint8_t BETWEENER_CONFIG_CHECK;
+
+
 //////////////////////////////////////////////////////////////////////////////
 //Now we define the Betweener class, which will let us make Betweener objects
 //in our sketches.  The class organizes a set of functions (called "methods") and
@@ -178,7 +201,10 @@ class Betweener
     
     public:
     
-    Betweener();  //constructor; initializes some Betweener-specific variables
+    //constructor; initializes some Betweener-specific variables.  It is
+    //written here, rather than in the .cpp file, so that the sketch's own
+    //copy of it reads the BETWEENER_CONFIG_CHECK above.
+    Betweener(){ (void)BETWEENER_CONFIG_CHECK; init(); };
     void begin(void); //starts up all the other objects this depends on
     
     
@@ -193,24 +219,77 @@ class Betweener
 
     //these read functions load up current values of all inputs into
     //the object.  Access those by accessing member variables, e.g.
-    // b.curentCV1
+    // b.curentCV1, or all at once with getInputs() (see below)
+#if BETWEENER_USE_TRIGGERS
     void readTriggers(void);  //reads all triggers
+#endif
+#if BETWEENER_USE_ANALOG_INPUTS
     void readCVs(void); //reads analog inputs (CV inputs)
     void readKnobs(void);  //reads potentiometer inputs
+#endif
+#if BETWEENER_USE_USB_MIDI
     void readUsbMIDI(void);  //reads MIDI via the usbMIDI arduino functionality
+#endif
 #ifdef DODINMIDI
     void readDINMIDI(void);  //reads MIDI via the 5-pin DIN connector
 #endif
     
-    void readAllInputs(void); //reads triggers, CV, knobs, and USB MIDI inputs, in that order
+    void readAllInputs(void); //reads triggers, CV, knobs, and USB MIDI inputs, in that order (those that are built)
+    
+    //A "snapshot" of all the inputs, as of the last read.  If some other
+    //part of your program that runs on its own schedule (a timer interrupt,
+    //the audio library, a telemetry stream...) reads b.currentCV(1) and then
+    //b.currentCV(2), the sketch may have read new values in between, so the
+    //two would not belong together.  getInputs() instead hands over a copy
+    //of everything that was read at the same time, plus when it was read.
+    //It is safe to call from anywhere, including interrupts, and never has
+    //to wait for the sketch.
+    struct InputSnapshot {
+        //the newest readings, which is what most readers want, come first
+        //so they sit together in memory
+        int cv[4];        //cv[0] is CV input 1, same as b.currentCV(1)
+        int knob[4];
+        uint8_t triggers;     //bit 0 = trigger 1 ... set while the trigger is high
+        uint8_t triggersRose; //set if that trigger rose at the last readTriggers()
+        uint8_t triggersFell; //set if it fell
+        uint32_t sequence;      //counts up by one every time new readings are published
+        uint32_t cvMicros;      //micros() when the CVs were last read
+        uint32_t knobMicros;    //... the knobs
+        uint32_t triggerMicros; //... the triggers
+        int lastCV[4];    //the readings before those, as in b.lastCV(1)
+        int lastKnob[4];
+    } __attribute__((aligned(32)));
     
+    void getInputs(InputSnapshot &copy);
+    //the sequence number of the newest snapshot.  If it has not changed,
+    //nothing has been read since you last looked.
+    uint32_t inputSequence(void){ return snapshotCount; };
+    
+#if BETWEENER_USE_ANALOG_INPUTS
     //these functions read individual channels and return the
     //values directly:
+    //(all of these are 10 bit numbers, 0-1023, unless you have asked for
+    //more bits with setCVAcquisition / setKnobAcquisition below)
     int readCV(int channel);   //returns a smoothed 10 bit number
     int readKnob(int channel);     //returns a smoothed 10 bit number
     
     int readCVRaw(int channel);  //returns an un-smoothed 10-bit number
     int readKnobRaw(int channel);  //returns an un-smoothed 10-bit number
+    
+    //"template" versions of the same functions, where the channel number
+    //goes in angle brackets instead:  b.readCV<1>() instead of b.readCV(1).
+    //They do exactly the same thing, but because the compiler knows the
+    //channel while it is compiling, it looks the pin up in the board profile
+    //(BetweenerBoards.h) right then and leaves just the reading of that
+    //pin, with no checking or choosing left to do while the sketch runs.
+    //A channel that does not exist, like readCV<5>(), will not compile.
+    //The channel has to be a plain number (or a const); use the ordinary
+    //versions when it is in a variable.  The same goes for the trigger
+    //functions and writeCVOut below.
+    template<int channel> int readCV(void);
+    template<int channel> int readKnob(void);
+    template<int channel> int readCVRaw(void);
+    template<int channel> int readKnobRaw(void);
 
     //these versions do some converting for you
     int readCVInputMIDI(int channel);
@@ -222,6 +301,7 @@ class Betweener
     //they also use the algorithm packaged with the smoothing algorithm.
     bool knobChanged(int knob);
     bool CVChanged(int cv_channel);
+#endif
     
     //functions that provide a convenient wrapping for Bounce2 functions.
     //note that because of the hardware implementation, a high trigger input
@@ -229,10 +309,16 @@ class Betweener
     //is actually read in as a falling trigger.  These functions do the right thing
     //so you don't have to keep track of it.
     //NOTE:  you must call readTriggers before these functions!
+#if BETWEENER_USE_TRIGGERS
     bool triggerRose(int trigger);
     bool triggerFell(int trigger);
     bool triggerHigh(int trigger);
     bool triggerLow(int trigger);
+    template<int trigger> bool triggerRose(void);
+    template<int trigger> bool triggerFell(void);
+    template<int trigger> bool triggerHigh(void);
+    template<int trigger> bool triggerLow(void);
+#endif
 
     
     
@@ -241,15 +327,118 @@ class Betweener
     //These functions assume you are using your sketch to decide directly what
     //output to write.  The functions are mainly useful for just hiding some of the
     //messier logic required by the specific DAC chip, etc.
-    void writeCVOut(int cvout, int value); //cvout selects channel 1 through 4; value is in range 0-4095
+    //writeCVOut is "static" (see the note on MCP4922_write below) so that other
+    //objects in this library, like the audio-library output object, can write
+    //the CV outs without needing their own Betweener object.  You can still
+    //call it the usual way, e.g. b.writeCVOut(1, 4095);
+    static void writeCVOut(int cvout, int value); //cvout selects channel 1 through 4; value is in range 0-4095
+    static int currentCVOut(int cvout);  //the value most recently written to a CV out
+    template<int cvout> static void writeCVOut(int value);  //e.g. b.writeCVOut<3>(4095)
+    
+    //If you write CV outs from inside an interrupt (a timer, a pin interrupt,
+    //or the Teensy Audio library's update), the SPI bus has to know about it,
+    //otherwise the interrupt could fire in the middle of another SPI message
+    //(to the other DAC, or to the SD card on the Audio shield) and garble both.
+    //Calling one of these once in setup() makes every other SPI user hold that
+    //interrupt off until their message is finished.
+    static void shareDACWithInterrupt(IRQ_NUMBER_t irq); //any interrupt, by number, e.g. IRQ_SOFTWARE
+    static void shareDACWithTimers(void);  //all the IntervalTimer interrupts
+    static void shareDACWithPin(uint8_t pin);  //a pin used with attachInterrupt()
+    
+    
+    /////////////////////////
+    //TIMED PULSE OUTPUT
+    //pulseCVOut sets an output to 'level' right away and sets it back to
+    //'restLevel' after duration_us microseconds, WITHOUT waiting for it
+    //(unlike writeCVOut + delay + writeCVOut).  A timer interrupt does the
+    //second write, so your sketch keeps running in the meantime.
+    //  - pulses on different outputs can overlap freely
+    //  - pulsing an output that is already pulsing restarts its timing
+    //    ("retrigger"), so a gate can be held open by repeated calls
+    //Use it for triggers (e.g. pulseCVOut(1, 4095, 15000) is a 15 ms
+    //trigger) or for gates of a known length.  The longest pulse is
+    //2^31 microseconds (about 35 minutes); longer ones are cut to that.
+    static void pulseCVOut(int cvout, int level, unsigned long duration_us, int restLevel = 0);
+    static bool pulseActive(int cvout);  //true while that output is mid-pulse
+    //light the LED while any pulse is active (pass false to stop that)
+    static void setPulseLED(bool mirror);
     
     //these are setup functions you can call to override parameter defaults before calling 'begin'
     //so that nothing needs to be recompiled to try different options.
     //the default options are hard-coded down below in this .h file
+#if BETWEENER_USE_BOUNCE
     void setBounceMillisec(int millisec){bounce_ms = millisec;};
+#endif
+#if BETWEENER_USE_SMOOTHING
     void setRASnapMultiplier(float snap){RASnapMultiplier = snap;};
-    void setRAActivityThreshold(int thresh){RAActivityThreshold=thresh;};
     void setRASleep(bool sleep){RASleep = sleep;};
+#endif
+#if BETWEENER_USE_ANALOG_INPUTS
+    void setRAActivityThreshold(int thresh){RAActivityThreshold=thresh;};
+#endif
+    
+    //FAST TRIGGERS
+    //By default each trigger input is read by its own Bounce object, which
+    //ignores changes for bounce_ms (5 ms) after each edge.  That is safe
+    //with a noisy cable, but it means a trigger cannot repeat faster than
+    //about 100 times a second.  useFastTriggers() switches to a quicker
+    //way: readTriggers() reads all four pins at once, straight from the
+    //processor's port registers, and an input only counts as changed once
+    //it has read the same new level 4 times in a row, tickMicros apart.
+    //So the debounce time is 4 ticks: with tickMicros = 0 (every
+    //readTriggers()) and a fast loop(), triggers can come at audio rates.
+    //triggerRose() and the other trigger functions work the same either
+    //way, but b.trig1 ... b.trig4 are only kept up to date by the Bounce
+    //way.  useBounceTriggers() switches back.
+#if BETWEENER_USE_TRIGGERS
+    void useFastTriggers(uint32_t tickMicros = 0);
+#endif
+#if BETWEENER_USE_BOUNCE
+    void useBounceTriggers(void){ fastTriggers = false; };
+#endif
+
+    //ADC SETTINGS
+    //By default every input is read once, as a 10 bit number (0-1023),
+    //with the Teensy averaging 4 conversions in hardware.  That is plenty
+    //for knobs, but a 1V/octave pitch CV needs finer steps: over the
+    //0-5V range, 10 bits is about 5 mV (a sixteenth of a semitone) per step
+    //before noise, and the noise makes it worse.
+    //
+    //setADCResolution picks how many bits each single conversion has
+    //(10, 12, 13 or 16; more bits take a little longer per conversion).
+    //It applies to every input, and takes effect straight away, before or
+    //after begin().
+    //
+    //setCVAcquisition and setKnobAcquisition then choose, for the CV
+    //inputs and the knobs separately:
+    //  bits:  how many bits you want the readings to have, 10 to 16
+    //  hardwareAveraging:  conversions the ADC averages by itself for
+    //      each reading: 1, 4, 8, 16 or 32
+    //  oversample:  how many of those readings the library adds up for
+    //      each value: 1, 2, 4, 8 or 16
+    //Adding up 4 readings gives one extra real bit (as long as there is
+    //a little noise, which there always is); 16 gives two.  So you cannot
+    //ask for more bits than the conversions plus that can give.  For
+    //example setADCResolution(12) and setCVAcquisition(13, 4, 4) gives
+    //13 bit CV readings (0-8191).
+    //
+    //All of this costs time: each CV read takes hardwareAveraging *
+    //oversample conversions per input.  CVReadMicros() and
+    //knobReadMicros() tell you how long the last readCVs() and
+    //readKnobs() actually took, so you can see what your settings cost.
+    //
+    //The functions that convert readings (CVtoMIDI, knobToCV...) and the
+    //smoothing all adjust to the bits you chose.
+    void setADCResolution(int bits);
+    void setCVAcquisition(int bits, int hardwareAveraging = 4, int oversample = 1);
+    void setKnobAcquisition(int bits, int hardwareAveraging = 4, int oversample = 1);
+    int CVBits(void){ return cvAcq.bits; };      //bits in each CV reading
+    int knobBits(void){ return knobAcq.bits; };  //bits in each knob reading
+    int ADCBits(void){ return adcBits; };        //bits in each single conversion
+    int CVMax(void){ return (1 << cvAcq.bits) - 1; };     //the biggest CV reading, e.g. 1023
+    int knobMax(void){ return (1 << knobAcq.bits) - 1; }; //the biggest knob reading
+    uint32_t CVReadMicros(void){ return cvReadMicros; };     //how long the last readCVs() took
+    uint32_t knobReadMicros(void){ return knobReadMicros_; }; //how long the last readKnobs() took
     
     //static means that these functions can be accessed without necessarily having
     //a "Betweener" object available.  Just by including this library/class,
@@ -263,40 +452,63 @@ class Betweener
     int knobToMIDI(int val);
     int knobToCV(int val);
 
-    // these are the variables we use to store current analog input readings,
-    // updated whenever a read operation is performed
-    int currentCV1;
-    int currentCV2;
-    int currentCV3;
-    int currentCV4;
-
-    // these are the variables that store current knob / pot readings,
-    // updated whenever a read operation is performed
-    int currentKnob1;
-    int currentKnob2;
-    int currentKnob3;
-    int currentKnob4;
-
-    // these are the variables we use to store previous values
-    // updated whenever a read operation is performed
-    int lastCV1;
-    int lastCV2;
-    int lastCV3;
-    int lastCV4;
-    
-    // these are the variables that store previous knob / pot readings,
-    // updated whenever a read operation is performed
-    int lastKnob1;
-    int lastKnob2;
-    int lastKnob3;
-    int lastKnob4;
+#if BETWEENER_USE_ANALOG_INPUTS
+    // the current and previous analog input readings, as left by the last
+    // read operation, e.g. b.currentCV(1) or b.lastKnob(4).  Inputs are 1-4;
+    // anything else gives -1.  These only look into the library's own copy
+    // of the input snapshot, so they cost no memory.
+    int currentCV(int channel){ return (channel >= 1 && channel <= 4) ? input.cv[channel - 1] : -1; };
+    int currentKnob(int knob){ return (knob >= 1 && knob <= 4) ? input.knob[knob - 1] : -1; };
+    int lastCV(int channel){ return (channel >= 1 && channel <= 4) ? input.lastCV[channel - 1] : -1; };
+    int lastKnob(int knob){ return (knob >= 1 && knob <= 4) ? input.lastKnob[knob - 1] : -1; };
+
+#if BETWEENER_USE_LEGACY_NAMES
+    // the older names for the same readings, b.currentCV1 and so on.  They
+    // used to be separate variables; now they are just other names
+    // ("references") for the entries in the input snapshot, so
+    // b.currentCV1 is the same thing as b.currentCV(1).  Each one still
+    // takes 4 bytes of RAM, though: set BETWEENER_USE_LEGACY_NAMES to 0 in
+    // BetweenerConfig.h to save those 64 bytes if your sketch uses the
+    // functions above instead.
+    int &currentCV1 = input.cv[0];
+    int &currentCV2 = input.cv[1];
+    int &currentCV3 = input.cv[2];
+    int &currentCV4 = input.cv[3];
+
+    // these are the names for the current knob / pot readings
+    int &currentKnob1 = input.knob[0];
+    int &currentKnob2 = input.knob[1];
+    int &currentKnob3 = input.knob[2];
+    int &currentKnob4 = input.knob[3];
+
+    // these are the names for the previous values
+    int &lastCV1 = input.lastCV[0];
+    int &lastCV2 = input.lastCV[1];
+    int &lastCV3 = input.lastCV[2];
+    int &lastCV4 = input.lastCV[3];
     
+    // these are the names for the previous knob / pot readings
+    int &lastKnob1 = input.lastKnob[0];
+    int &lastKnob2 = input.lastKnob[1];
+    int &lastKnob3 = input.lastKnob[2];
+    int &lastKnob4 = input.lastKnob[3];
+
+    //because of those references, copying a whole Betweener would make a
+    //copy whose currentCV1 still means the original's.  Nothing needs to
+    //copy one, so we simply forbid it.
+    Betweener(const Betweener &) = delete;
+    Betweener &operator=(const Betweener &) = delete;
+#endif
+#endif
+    
+#if BETWEENER_USE_BOUNCE
     // these are the trigger inputs.  We use the Bounce library, which provides
     // a way to avoid accidental triggers due to fluctuating inputs
     Bounce trig1;
     Bounce trig2;
     Bounce trig3;
     Bounce trig4;
+#endif
     
     
     //midi interface.  Don't freak out about how weird this looks.  Look up "c++ templates" for more info.
@@ -319,24 +531,253 @@ class Betweener
     //accident, so those go here.  Also we hide the smoothing-analog-read objects here.
     private:
 
+    //the sample and hold converts from inside its trigger interrupt, with
+    //its own hardware averaging, so it needs to see (and put back) ours
+    friend class BetweenerSampleHold;
+
+    //the recorder takes its frames inside its timer interrupt, so they
+    //keep coming while loop() is busy writing to the card.  This reads
+    //all 8 analog inputs (as readCVRaw and readKnobRaw would, without the
+    //smoothing) and the trigger pins (without the debouncing), and puts
+    //back the ADC averaging that loop() was using.
+    friend class BetweenerRecorder;
+
+    void init(void);  //the constructor's work
+    void sampleInputsFromInterrupt(uint16_t values[8], uint8_t &triggers);
+
+    //the last value written to each CV out, whoever wrote it
+    static volatile uint16_t CVOutValues[4];
+
+    //the chip select and the two bytes of one DAC write, without the SPI
+    //transaction around them
+    static void MCP4922_send(int cs_pin, byte dac, int value);
+
+#if BETWEENER_USE_BOUNCE
     int bounce_ms = 5;
+#endif
+
+#if BETWEENER_USE_TRIGGERS
+    //the fast trigger front end's state.  A "vertical counter": bit i of
+    //the two bytes together is a 2 bit counter for trigger i+1, so all
+    //four inputs are debounced at once with a few logic operations.
+    //Without Bounce it is the only way the triggers are read.
+    bool fastTriggers = !BETWEENER_USE_BOUNCE;
+    uint32_t triggerTickMicros = 0;
+    uint32_t lastTriggerTick = 0;
+    uint8_t triggerCount0 = 0xFF;
+    uint8_t triggerCount1 = 0xFF;
+    void updateFastTriggers(void);
+#endif
+#if BETWEENER_USE_SMOOTHING
     float RASnapMultiplier = 0.015; //snapMultiplier parameter for the ResponsiveAnalogRead library
-    int RAActivityThreshold = 10; //activity threshold parameter for ResponsiveAnalogRead
     bool RASleep = true;  //sleep parameter for ResponsiveAnalogRead
+#endif
+    int RAActivityThreshold = 10; //activity threshold parameter for ResponsiveAnalogRead
+    
+    //how one group of inputs (the CVs, or the knobs) gets read.  See
+    //setCVAcquisition in the .cpp file for how the numbers are worked out.
+    struct Acquisition {
+        uint8_t bits;               //bits in each reading we hand out
+        uint8_t hardwareAveraging;  //conversions the ADC averages per analogRead
+        uint8_t oversampleShift;    //we add up 2^oversampleShift analogReads...
+        int8_t resultShift;         //...and shift the sum right this far (left if negative)
+    };
+    Acquisition cvAcq = {10, 4, 0, 0};
+    Acquisition knobAcq = {10, 4, 0, 0};
+    uint8_t adcBits = 10;  //bits per conversion
+    uint32_t cvReadMicros = 0;
+    uint32_t knobReadMicros_ = 0;
+    
+    //hardware averaging belongs to the whole ADC, so it is switched over
+    //(only when it differs) before each group is read
+    static uint8_t adcAveraging;
+    static void useAveraging(uint8_t n){
+        if (n != adcAveraging){
+            //note the setting first: an interrupt that borrows the ADC
+            //(BetweenerSampleHold) puts back whatever this says
+            adcAveraging = n;
+            analogReadAveraging(n);
+        }
+    };
+    
+    //one reading of a pin the way the group's settings say
+    static int acquire(uint8_t pin, const Acquisition &a){
+        useAveraging(a.hardwareAveraging);
+        int32_t sum = 0;
+        for (int n = 0; n < (1 << a.oversampleShift); n++){
+            sum += analogRead(pin);
+        }
+        return (a.resultShift >= 0) ? (sum >> a.resultShift) : (sum << -a.resultShift);
+    };
+    bool setAcquisition(Acquisition &a, int bits, int hardwareAveraging, int oversample);
+    void setUpSmoothing(void);
     
-    ResponsiveAnalogRead smoothKnob1;
-    ResponsiveAnalogRead smoothKnob2;
-    ResponsiveAnalogRead smoothKnob3;
-    ResponsiveAnalogRead smoothKnob4;
+#if BETWEENER_USE_SMOOTHING
+    //one smoothing object per input, in channel order (channel 1 is [0])
+    ResponsiveAnalogRead smoothKnob[4];
+    ResponsiveAnalogRead smoothCV[4];
+#endif
+    
+    //The inputs as the sketch is reading them.  Only the sketch's own
+    //read functions change this copy.
+    InputSnapshot input;
+    
+    //The published copies that getInputs() reads from.  publishInputs()
+    //always writes the one that is NOT the newest and then switches over,
+    //so a reader that interrupts it halfway still finds a complete
+    //snapshot in the other one.  Each copy also has its own counter
+    //(a "seqlock") that is odd while it is being written, which lets
+    //getInputs() notice the rare case of reading a copy that changed
+    //underneath it, and simply read again.
+    InputSnapshot published[2];
+    volatile uint32_t publishLock[2] = {0, 0};
+    volatile uint32_t snapshotCount = 0;
+    void publishInputs(void);
+#if BETWEENER_USE_TRIGGERS
+    void updateTriggers(void);
+#endif
+#if BETWEENER_USE_ANALOG_INPUTS
+    void updateCVs(void);
+    void updateKnobs(void);
+#endif
     
-    ResponsiveAnalogRead smoothCV1;
-    ResponsiveAnalogRead smoothCV2;
-    ResponsiveAnalogRead smoothCV3;
-    ResponsiveAnalogRead smoothCV4;
-  
+#if BETWEENER_USE_BOUNCE
+    //begin() and updateTriggers() look each trigger's Bounce object up in
+    //this table instead of needing a separate case for every trigger.
+    //It is a table of "pointers to members": triggers[0] means "the trig1
+    //of whichever Betweener".
+    static constexpr Bounce Betweener::* triggers[4] = {&Betweener::trig1, &Betweener::trig2, &Betweener::trig3, &Betweener::trig4};
+#endif
+    
+#if BETWEENER_USE_ANALOG_INPUTS
+    //the shared guts of the read functions.  'i' is the channel minus one,
+    //already checked to be 0-3.  Without smoothing a reading is used as
+    //it comes.
+    int readCVAt(int i){
+        input.lastCV[i] = input.cv[i];
+#if BETWEENER_USE_SMOOTHING
+        smoothCV[i].update(acquire(BETWEENER_BOARD.cvInPins[i], cvAcq));
+        input.cv[i] = smoothCV[i].getValue();
+#else
+        input.cv[i] = acquire(BETWEENER_BOARD.cvInPins[i], cvAcq);
+#endif
+        return input.cv[i];
+    };
+    int readKnobAt(int i){
+        input.lastKnob[i] = input.knob[i];
+#if BETWEENER_USE_SMOOTHING
+        smoothKnob[i].update(acquire(BETWEENER_BOARD.knobPins[i], knobAcq));
+        input.knob[i] = smoothKnob[i].getValue();
+#else
+        input.knob[i] = acquire(BETWEENER_BOARD.knobPins[i], knobAcq);
+#endif
+        return input.knob[i];
+    };
+#endif
     
 };
 
 
+//////////////////////////////////////////////////////////////////////////////
+//The template functions.  Unlike the rest of the class, these have to live
+//here in the .h file: the compiler writes a separate copy of each one for
+//every channel number a sketch actually uses, so it needs to see the code
+//while it is compiling the sketch.  Each one is just a check that the
+//channel exists (the static_assert, which stops the compile with the
+//message if it fails) and then the table lookup, done by the compiler.
+
+#if BETWEENER_USE_ANALOG_INPUTS
+template<int channel> int Betweener::readCV(void){
+    static_assert(channel >= 1 && channel <= 4, "the Betweener has CV inputs 1 to 4");
+    const int value = readCVAt(channel - 1);
+    input.cvMicros = micros();
+    publishInputs();
+    return value;
+}
+
+template<int channel> int Betweener::readKnob(void){
+    static_assert(channel >= 1 && channel <= 4, "the Betweener has knobs 1 to 4");
+    const int value = readKnobAt(channel - 1);
+    input.knobMicros = micros();
+    publishInputs();
+    return value;
+}
+
+template<int channel> int Betweener::readCVRaw(void){
+    static_assert(channel >= 1 && channel <= 4, "the Betweener has CV inputs 1 to 4");
+    return acquire(BETWEENER_BOARD.cvInPins[channel - 1], cvAcq);
+}
+
+template<int channel> int Betweener::readKnobRaw(void){
+    static_assert(channel >= 1 && channel <= 4, "the Betweener has knobs 1 to 4");
+    return acquire(BETWEENER_BOARD.knobPins[channel - 1], knobAcq);
+}
+#endif
+
+#if BETWEENER_USE_TRIGGERS
+//the trigger states and edges are bits in the input snapshot, already the
+//right way up (see updateTriggers in the .cpp file)
+template<int trigger> bool Betweener::triggerRose(void){
+    static_assert(trigger >= 1 && trigger <= 4, "the Betweener has triggers 1 to 4");
+    return input.triggersRose & (1 << (trigger - 1));
+}
+
+template<int trigger> bool Betweener::triggerFell(void){
+    static_assert(trigger >= 1 && trigger <= 4, "the Betweener has triggers 1 to 4");
+    return input.triggersFell & (1 << (trigger - 1));
+}
+
+template<int trigger> bool Betweener::triggerHigh(void){
+    static_assert(trigger >= 1 && trigger <= 4, "the Betweener has triggers 1 to 4");
+    return input.triggers & (1 << (trigger - 1));
+}
+
+template<int trigger> bool Betweener::triggerLow(void){
+    static_assert(trigger >= 1 && trigger <= 4, "the Betweener has triggers 1 to 4");
+    return !(input.triggers & (1 << (trigger - 1)));
+}
+#endif
+
+template<int cvout> void Betweener::writeCVOut(int value){
+    static_assert(cvout >= 1 && cvout <= 4, "the Betweener has CV outs 1 to 4");
+    //the value is stored inside the same SPI transaction as the write, so
+    //an interrupt that shares the DACs (see shareDACWithInterrupt) cannot
+    //come between them and leave currentCVOut() disagreeing with the DAC
+    SPI.beginTransaction(SPISettings(BETWEENER_BOARD.dacSPIClock,MSBFIRST,SPI_MODE0));
+    MCP4922_send(BETWEENER_BOARD.cvOutChipSelect[cvout - 1], BETWEENER_BOARD.cvOutDACChannel[cvout - 1], value);
+    CVOutValues[cvout - 1] = value;
+    SPI.endTransaction();
+}
+
+//MCP4922_write is "inline" (its code is copied into each place that calls
+//it) so that when the chip select pin is known while compiling, as it is
+//in writeCVOut<>, the pin changes become single instructions.
+inline void Betweener::MCP4922_write(int cs_pin, byte dac, int value){
+    //Using beginTransaction and endTransaction to allow for the use of audio shield at the
+    //same time.  The settings here are for SPI communication with the chip, which
+    //works with the default mode 0 and with byte order MSB first.  The clock
+    //speed comes from the board profile.
+    //Note the chip select goes low only *inside* the transaction.  If the DACs are
+    //also written from an interrupt (see shareDACWithInterrupt), the transaction
+    //holds that interrupt off, so two chip selects can never be low at once.
+    SPI.beginTransaction(SPISettings(BETWEENER_BOARD.dacSPIClock,MSBFIRST,SPI_MODE0));
+    MCP4922_send(cs_pin, dac, value);
+    SPI.endTransaction();
+}
+
+inline void Betweener::MCP4922_send(int cs_pin, byte dac, int value){
+    // Adapted from code by Sebastian Tomczak
+    // from a tutorial here:  http://little-scale.blogspot.com/2016/11/teensy-and-mcp4922-dual-channel-12-bit.html
+
+    byte low = value & 0xff;
+    byte high = (value >> 8) & 0x0f;
+    dac = (dac & 1) << 7;
+    digitalWrite(cs_pin, LOW);
+    SPI.transfer(dac | 0x30 | high);
+    SPI.transfer(low);
+    digitalWrite(cs_pin, HIGH);
+}
+
+
 
 #endif /* Betweener_h */
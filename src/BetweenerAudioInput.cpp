@@ -0,0 +1,265 @@
+//
+//  BetweenerAudioInput.cpp
+//
+//  Copyright (c) 2018 Kathryn Schaffer
+
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+//  BetweenerAudioInput.cpp detailed description:
+//
+//  Implementation of AudioInputBetweenerCV.  See BetweenerAudioInput.h for
+//  how to use it.  This file talks directly to the Teensy 3.2's ADC, PDB
+//  and DMA registers, so it is less beginner-friendly than the rest of the
+//  library; the Kinetis K20 reference manual is the place to look things up.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "BetweenerAudioInput.h"
+
+AudioInputBetweenerCV * AudioInputBetweenerCV::active_ = NULL;
+bool AudioInputBetweenerCV::updateResponsibility_ = false;
+DMAChannel AudioInputBetweenerCV::dmaResult_(false);
+DMAChannel AudioInputBetweenerCV::dmaMux_(false);
+
+//the raw ADC results, four inputs interleaved, in two halves.  While DMA
+//fills one half, the interrupt converts the other.
+DMAMEM static uint16_t cvInBuffer[2 * AUDIO_BLOCK_SAMPLES * 4];
+
+#if defined(__MK20DX256__)
+//ADC0 channel numbers for CVIN1..CVIN4 (pins A7, A6, A3, A2).  A7 and A6
+//are the "b" variants of channels 7 and 6 (SE7b and SE6b), which is why
+//begin() sets MUXSEL.  (SE5b would be A0, the DACs' SPI clock.)
+//This table is in the order the inputs are converted.
+static const uint32_t cvInChannels[4] = {7, 6, 9, 8};
+
+//the second DMA channel writes these into ADC0_SC1A after each conversion,
+//so it is the same table rotated by one: after CVIN1 comes CVIN2, etc.
+static uint32_t cvInNextChannel[4] __attribute__((aligned(16))) = {6, 9, 8, 7};
+
+//the ADC channel numbers are only right for the pins they were worked out
+//for; a board profile that moves the CV inputs needs a new table here
+static_assert(BETWEENER_BOARD.cvInPins[0] == A7 && BETWEENER_BOARD.cvInPins[1] == A6
+              && BETWEENER_BOARD.cvInPins[2] == A3 && BETWEENER_BOARD.cvInPins[3] == A2,
+              "AudioInputBetweenerCV's ADC channel table does not match this board profile's CV input pins");
+#endif
+
+
+void AudioInputBetweenerCV::setDecimation(int n){
+    int d = 1;
+    while (d < BETWEENER_CV_MAX_DECIMATION && d < n){
+        d = d * 2;
+    }
+    if (d != n){
+        DEBUG_PRINTLN("AudioInputBetweenerCV: decimation must be 1, 2, 4, 8 or 16");
+    }
+    decimation_ = d;
+}
+
+
+float AudioInputBetweenerCV::conversionsPerSecond(void){
+    return 4.0 * AUDIO_SAMPLE_RATE_EXACT / decimation_;
+}
+
+
+void AudioInputBetweenerCV::begin(void){
+#if defined(__MK20DX256__)
+    active_ = this;
+
+    //the processor's cycle counter is what we use for the load measurement
+    ARM_DEMCR |= ARM_DEMCR_TRCENA;
+    ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+
+    //let the Teensy core set up and calibrate ADC0 for 12 bits with no
+    //hardware averaging, by doing one ordinary read.  Without averaging a
+    //conversion takes about 2.5us, comfortably inside the 5.7us we get
+    //between PDB triggers at the full rate.
+    analogReadRes(12);
+    analogReadAveraging(1);
+    analogRead(CVIN1);
+
+    //now take it over: select the "b" channels, start conversions from the
+    //hardware trigger (the PDB) instead of from register writes, and ask
+    //for a DMA request each time a conversion finishes
+    ADC0_CFG2 |= ADC_CFG2_MUXSEL;
+    ADC0_SC3 = 0;
+    ADC0_SC2 |= ADC_SC2_ADTRG | ADC_SC2_DMAEN;
+    ADC0_SC1A = cvInChannels[0];
+
+    const int frames = AUDIO_BLOCK_SAMPLES / decimation_;
+
+    //DMA channel 1: ADC result -> buffer, interrupting at each half
+    dmaResult_.begin(true);
+    dmaResult_.source((uint16_t &)ADC0_RA);
+    dmaResult_.destinationBuffer(cvInBuffer, 2 * frames * 4 * sizeof(uint16_t));
+    dmaResult_.triggerAtHardwareEvent(DMAMUX_SOURCE_ADC0);
+    dmaResult_.interruptAtHalf();
+    dmaResult_.interruptAtCompletion();
+    dmaResult_.attachInterrupt(isr);
+
+    //DMA channel 2: next channel number -> ADC0_SC1A, run each time
+    //channel 1 moves a result.  In hardware-trigger mode, writing SC1A
+    //only selects the input; the conversion waits for the next PDB tick.
+    dmaMux_.begin(true);
+    dmaMux_.sourceCircular(cvInNextChannel, sizeof(cvInNextChannel));
+    dmaMux_.destination(ADC0_SC1A);
+    dmaMux_.transferSize(4);
+    dmaMux_.transferCount(4);
+    dmaMux_.triggerAtTransfersOf(dmaResult_);
+
+    updateResponsibility_ = update_setup();
+
+    dmaMux_.enable();
+    dmaResult_.enable();
+
+    //finally start the PDB, four conversions per (decimated) frame
+    const uint32_t period = (uint32_t)(F_BUS / conversionsPerSecond() + 0.5);
+    SIM_SCGC6 |= SIM_SCGC6_PDB;
+    PDB0_IDLY = 1;
+    PDB0_MOD = period - 1;
+    PDB0_SC = PDB_SC_TRGSEL(15) | PDB_SC_PDBEN | PDB_SC_CONT | PDB_SC_LDOK;
+    PDB0_SC = PDB_SC_TRGSEL(15) | PDB_SC_PDBEN | PDB_SC_CONT | PDB_SC_SWTRIG;
+    PDB0_CH0C1 = 0x0101;  //pre-trigger 0 of ADC0 on, no delay
+
+    resetStats();
+#else
+    DEBUG_PRINTLN("AudioInputBetweenerCV only works on the Teensy 3.2");
+#endif
+}
+
+
+void AudioInputBetweenerCV::resetStats(void){
+    __disable_irq();
+    blocksDelivered_ = 0;
+    blocksDropped_ = 0;
+    isrCyclesMax_ = 0;
+    isrCyclesTotal_ = 0;
+    statsStartMicros_ = micros();
+    __enable_irq();
+}
+
+
+float AudioInputBetweenerCV::cpuLoad(void){
+    __disable_irq();
+    uint64_t busy = isrCyclesTotal_;
+    uint32_t elapsed = micros() - statsStartMicros_;
+    __enable_irq();
+    if (elapsed == 0) return 0.0;
+    return 100.0 * (float)busy / ((float)elapsed * (F_CPU / 1000000));
+}
+
+
+void AudioInputBetweenerCV::isr(void){
+#if defined(__MK20DX256__)
+    const uint32_t start = ARM_DWT_CYCCNT;
+    AudioInputBetweenerCV *self = active_;
+    const int d = self->decimation_;
+    const int frames = AUDIO_BLOCK_SAMPLES / d;
+
+    //work out which half the DMA just finished with: the one it is NOT
+    //writing into right now
+    const uint32_t daddr = (uint32_t)(dmaResult_.TCD->DADDR);
+    dmaResult_.clearInterrupt();
+    const uint16_t *src;
+    if (daddr < (uint32_t)cvInBuffer + frames * 4 * sizeof(uint16_t)){
+        src = cvInBuffer + frames * 4;
+    }else{
+        src = cvInBuffer;
+    }
+
+    if (!self->ready_ && self->blocks_[0]){
+        //one pass: de-interleave, scale 12 bits up to the audio library's
+        //16, and repeat each sample d times when decimating
+        int16_t *out0 = self->blocks_[0]->data;
+        int16_t *out1 = self->blocks_[1]->data;
+        int16_t *out2 = self->blocks_[2]->data;
+        int16_t *out3 = self->blocks_[3]->data;
+        for (int f = 0; f < frames; f++){
+            const int16_t v0 = (int16_t)(src[0] << 3);
+            const int16_t v1 = (int16_t)(src[1] << 3);
+            const int16_t v2 = (int16_t)(src[2] << 3);
+            const int16_t v3 = (int16_t)(src[3] << 3);
+            src += 4;
+            for (int k = 0; k < d; k++){
+                *out0++ = v0;
+                *out1++ = v1;
+                *out2++ = v2;
+                *out3++ = v3;
+            }
+        }
+        self->ready_ = true;
+    }else{
+        //update() has not collected the last blocks yet, or the audio
+        //library ran out of memory for new ones
+        self->blocksDropped_++;
+    }
+
+    if (updateResponsibility_) update_all();
+
+    const uint32_t cycles = ARM_DWT_CYCCNT - start;
+    self->isrCyclesLast_ = cycles;
+    if (cycles > self->isrCyclesMax_) self->isrCyclesMax_ = cycles;
+    self->isrCyclesTotal_ += cycles;
+#endif
+}
+
+
+void AudioInputBetweenerCV::update(void){
+    audio_block_t *fresh[4] = {NULL, NULL, NULL, NULL};
+    audio_block_t *full[4] = {NULL, NULL, NULL, NULL};
+
+    //get new blocks ready for the interrupt if it will need them.  The
+    //audio library's allocate() turns interrupts on and off itself, so
+    //this has to happen before our own critical section below.
+    if (ready_ || !blocks_[0]){
+        for (int ch = 0; ch < 4; ch++){
+            fresh[ch] = allocate();
+            if (!fresh[ch]){
+                //all four or none
+                for (int i = 0; i < ch; i++){
+                    release(fresh[i]);
+                    fresh[i] = NULL;
+                }
+                break;
+            }
+        }
+    }
+
+    //swap the full blocks out and the fresh ones in, without the
+    //interrupt seeing a half-swapped set
+    __disable_irq();
+    bool haveFull = ready_;
+    if (haveFull || !blocks_[0]){
+        for (int ch = 0; ch < 4; ch++){
+            full[ch] = blocks_[ch];
+            blocks_[ch] = fresh[ch];
+            fresh[ch] = NULL;
+        }
+        ready_ = false;
+    }
+    __enable_irq();
+
+    for (int ch = 0; ch < 4; ch++){
+        if (full[ch]){
+            if (haveFull) transmit(full[ch], ch);
+            release(full[ch]);
+        }
+        if (fresh[ch]) release(fresh[ch]);
+    }
+    if (haveFull) blocksDelivered_++;
+}
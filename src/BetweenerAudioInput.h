@@ -0,0 +1,123 @@
+//
+//  BetweenerAudioInput.h
+//
+//  Copyright (c) 2018 Kathryn Schaffer
+
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////
+//  BetweenerAudioInput.h detailed description:
+//
+//  This file defines AudioInputBetweenerCV, an "input object" for the Teensy
+//  Audio library with four outputs: CV inputs 1 through 4.  It lets the
+//  audio library do things to incoming CV that would be hopeless at loop()
+//  speed, like envelope following, filtering, or pitch detection.
+//
+//  How it works, briefly:
+//      - The "programmable delay block" (PDB), a hardware timer, starts an
+//        ADC conversion at exactly four times the audio sample rate.
+//      - Each finished conversion is copied into a buffer by DMA (a
+//        hardware copier that runs without the processor), and a second
+//        DMA channel switches the ADC to the next CV input, so the four
+//        inputs are sampled round-robin.
+//      - Every 128 frames, an interrupt converts the buffer straight into
+//        the audio library's own blocks, in one pass, and hands them on.
+//
+//  setDecimation(n), with n = 1, 2, 4, 8 or 16, samples n times less often
+//  and repeats each sample n times in the block.  That keeps the audio
+//  graph at 44.1 kHz but cuts the ADC and interrupt load when the CV does
+//  not change that quickly.
+//
+//  Samples are unipolar: 0V in is 0.0 and 5V in is (almost) 1.0.
+//
+//  IMPORTANT LIMITATIONS
+//      - While this object is running it owns ADC0, so do not call
+//        readCVs(), readKnobs(), readCV() or analogRead() at the same time.
+//      - It uses the PDB, which AudioInputAnalog and AudioOutputAnalog also
+//        use, so it cannot be combined with those two.  The Audio shield
+//        (AudioOutputI2S) and AudioOutputBetweenerCV are fine.
+//      - It is written for the Teensy 3.2 that the Betweener is built on.
+//
+//  The object also keeps count of how many blocks it has delivered or
+//  dropped and how many processor cycles its interrupt takes, so you can
+//  see what it costs.  The audio library's own processorUsage() covers the
+//  rest (the update() function).
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef BetweenerAudioInput_h
+#define BetweenerAudioInput_h
+
+#include <Arduino.h>
+#include <AudioStream.h>
+#include <DMAChannel.h>
+#include "Betweener.h"
+
+#define BETWEENER_CV_MAX_DECIMATION 16
+
+
+class AudioInputBetweenerCV : public AudioStream
+{
+    public:
+
+    AudioInputBetweenerCV(void) : AudioStream(0, NULL) {}
+
+    //call this in setup(), after Betweener's begin() and AudioMemory()
+    void begin(void);
+
+    //sample every n-th frame only (1, 2, 4, 8 or 16).  Call before begin().
+    void setDecimation(int n);
+
+    //measurements
+    uint32_t blocksDelivered(void){ return blocksDelivered_; };
+    uint32_t blocksDropped(void){ return blocksDropped_; };
+    uint32_t isrCyclesLast(void){ return isrCyclesLast_; };  //cycles for the last block
+    uint32_t isrCyclesMax(void){ return isrCyclesMax_; };    //worst block since resetStats()
+    float conversionsPerSecond(void); //ADC conversions per second, all four inputs together
+    float cpuLoad(void);  //percent of the processor used by the interrupt since resetStats()
+    void resetStats(void);
+
+    virtual void update(void);
+
+
+    private:
+
+    static void isr(void);
+
+    static AudioInputBetweenerCV *active_;
+    static bool updateResponsibility_;
+    static DMAChannel dmaResult_;  //copies each ADC result into the buffer
+    static DMAChannel dmaMux_;     //then points the ADC at the next input
+
+    int decimation_ = 1;
+
+    //blocks being filled by the interrupt, and whether they are full
+    audio_block_t * volatile blocks_[4] = {NULL, NULL, NULL, NULL};
+    volatile bool ready_ = false;
+
+    volatile uint32_t blocksDelivered_ = 0;
+    volatile uint32_t blocksDropped_ = 0;
+    volatile uint32_t isrCyclesLast_ = 0;
+    volatile uint32_t isrCyclesMax_ = 0;
+    volatile uint64_t isrCyclesTotal_ = 0;
+    uint32_t statsStartMicros_ = 0;
+};
+
+
+#endif /* BetweenerAudioInput_h */
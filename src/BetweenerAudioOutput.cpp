@@ -0,0 +1,190 @@
+//
+//  BetweenerAudioOutput.cpp
+//
+//  Copyright (c) 2018 Kathryn Schaffer
+
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+//  BetweenerAudioOutput.cpp detailed description:
+//
+//  Implementation of AudioOutputBetweenerCV.  See BetweenerAudioOutput.h for
+//  how to use it.
+//
+//  There are two "interrupt" contexts in here, and it helps to keep them apart:
+//      - update() is called by the audio library, at low priority, once per
+//        128-sample block.  It turns each block into DAC codes.
+//      - timerISR() is called by an IntervalTimer.  It plays the DAC codes
+//        out at an even rate, and (if nothing else is doing it) tells the
+//        audio library when it is time for the next block.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "BetweenerAudioOutput.h"
+
+AudioOutputBetweenerCV * AudioOutputBetweenerCV::active_ = NULL;
+bool AudioOutputBetweenerCV::updateResponsibility_ = false;
+
+
+bool AudioOutputBetweenerCV::begin(void){
+    active_ = this;
+
+    //update() writes to the DACs from the audio library's software
+    //interrupt, and the timer may do so too.  Let SPI know, so CV writes
+    //from loop() and SD card reads on the Audio shield are not interrupted
+    //halfway through.
+    Betweener::shareDACWithInterrupt(IRQ_SOFTWARE);
+    Betweener::shareDACWithTimers();
+
+    //if there is no Audio shield or other output object, somebody has to
+    //tell the audio library to process the next block.  update_setup()
+    //returns true if that somebody is us.
+    updateResponsibility_ = update_setup();
+
+    return setSamplesPerWrite(samplesPerWrite_);
+}
+
+
+bool AudioOutputBetweenerCV::setSamplesPerWrite(int samples){
+    //round down to a power of two we can handle
+    int n = AUDIO_BLOCK_SAMPLES;
+    while (n > BETWEENER_CV_MIN_SAMPLES_PER_WRITE && n > samples){
+        n = n / 2;
+    }
+    if (n != samples){
+        DEBUG_PRINTLN("AudioOutputBetweenerCV: samples per write must be 8, 16, 32, 64 or 128");
+    }
+
+    timer_.end();
+    samplesPerWrite_ = n;
+    ringWritten_ = 0;
+    ringRead_ = 0;
+    ticks_ = 0;
+
+    if (active_ != this){
+        //begin() has not been called yet; it will start the timer
+        return true;
+    }
+
+    //we need the timer if values are played out between blocks, or if we
+    //are the ones keeping the audio library going.  One value per block
+    //with another output in charge needs no timer at all: update() writes
+    //the DACs itself.
+    if (n < AUDIO_BLOCK_SAMPLES || updateResponsibility_){
+        if (!timer_.begin(timerISR, (float)(1000000.0 * n / AUDIO_SAMPLE_RATE_EXACT))){
+            DEBUG_PRINTLN("AudioOutputBetweenerCV: all the hardware timers (IntervalTimers) are in use!");
+            return false;
+        }
+    }
+    return true;
+}
+
+
+float AudioOutputBetweenerCV::writeRate(void){
+    return AUDIO_SAMPLE_RATE_EXACT / samplesPerWrite_;
+}
+
+
+void AudioOutputBetweenerCV::update(void){
+    audio_block_t *block[4];
+    const int n = samplesPerWrite_;
+    const int groups = AUDIO_BLOCK_SAMPLES / n;
+    const bool bipolar = bipolar_;
+    const bool average = (mode_ == BETWEENER_CV_AVERAGE);
+
+    for (int ch = 0; ch < 4; ch++){
+        block[ch] = receiveReadOnly(ch);
+    }
+
+    //one value per block: reduce each channel and write it right now
+    if (n == AUDIO_BLOCK_SAMPLES){
+        for (int ch = 0; ch < 4; ch++){
+            int32_t value = 0;
+            if (block[ch]){
+                if (average){
+                    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) value += block[ch]->data[i];
+                    value = value / AUDIO_BLOCK_SAMPLES;
+                }else{
+                    value = block[ch]->data[0];
+                }
+            }
+            //an unconnected input (no block) is silence, as usual for the audio library
+            Betweener::writeCVOut(ch + 1, sampleToDAC(value, bipolar));
+        }
+    }else{
+        //several values per block: put them in the ring for the timer
+        uint32_t written = ringWritten_;
+        if (written + groups - ringRead_ > (uint32_t)RING_FRAMES){
+            //the timer has fallen too far behind; throw away what it has
+            //not played yet rather than overwrite it in the middle
+            overruns_++;
+            ringRead_ = written;
+        }
+        for (int g = 0; g < groups; g++){
+            uint16_t *frame = ring_[(written + g) % RING_FRAMES];
+            for (int ch = 0; ch < 4; ch++){
+                int32_t value = 0;
+                if (block[ch]){
+                    const int16_t *p = block[ch]->data + g * n;
+                    if (average){
+                        for (int i = 0; i < n; i++) value += p[i];
+                        value = value / n;
+                    }else{
+                        value = p[0];
+                    }
+                }
+                frame[ch] = sampleToDAC(value, bipolar);
+            }
+        }
+        //publish the new frames only once they are all filled in
+        ringWritten_ = written + groups;
+    }
+
+    for (int ch = 0; ch < 4; ch++){
+        if (block[ch]) release(block[ch]);
+    }
+}
+
+
+void AudioOutputBetweenerCV::timerISR(void){
+    AudioOutputBetweenerCV *self = active_;
+    if (!self) return;
+
+    const int n = self->samplesPerWrite_;
+
+    if (n < AUDIO_BLOCK_SAMPLES){
+        if (self->ringRead_ != self->ringWritten_){
+            const uint16_t *frame = self->ring_[self->ringRead_ % RING_FRAMES];
+            Betweener::writeCVOut(1, frame[0]);
+            Betweener::writeCVOut(2, frame[1]);
+            Betweener::writeCVOut(3, frame[2]);
+            Betweener::writeCVOut(4, frame[3]);
+            self->ringRead_++;
+        }else{
+            //nothing new yet, so the outputs simply hold their last value
+            self->underruns_++;
+        }
+    }
+
+    //once per block's worth of ticks, ask the audio library for the next block
+    self->ticks_++;
+    if (updateResponsibility_ && self->ticks_ >= (uint32_t)(AUDIO_BLOCK_SAMPLES / n)){
+        self->ticks_ = 0;
+        update_all();
+    }
+}
@@ -0,0 +1,149 @@
+//
+//  BetweenerAudioOutput.h
+//
+//  Copyright (c) 2018 Kathryn Schaffer
+
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////
+//  BetweenerAudioOutput.h detailed description:
+//
+//  This file defines AudioOutputBetweenerCV, an "output object" for the
+//  Teensy Audio library.  You patch it into an audio graph the same way you
+//  would patch in AudioOutputAnalog or AudioOutputI2S, except that its four
+//  inputs end up on the Betweener's four CV outputs instead of a speaker.
+//
+//  Audio blocks are 128 samples long, and a new one arrives about every
+//  2.9 milliseconds.  The DACs cannot usefully be written 44 thousand times
+//  a second (and CV does not need it), so the object reduces each block to
+//  a smaller number of values:
+//      - setSamplesPerWrite(128) (the default) writes one value per block,
+//        straight from the audio library's update interrupt (~344 Hz).
+//      - setSamplesPerWrite(8, 16, 32 or 64) writes one value per that many
+//        samples (5.5 kHz down to 690 Hz).  Those values are played out
+//        evenly by a timer, one block behind the audio graph.
+//  Each value is either the sample at the start of its group
+//  (BETWEENER_CV_HOLD) or the average of the group (BETWEENER_CV_AVERAGE,
+//  which smooths out anything faster than the write rate).
+//
+//  By default the signal is treated as unipolar, like an envelope:
+//  0.0 and below gives 0V and 1.0 gives full scale.  setBipolar(true) maps
+//  -1.0 ... 1.0 to the full range instead, which suits LFOs.
+//
+//  If the sketch has no other audio output (no Audio shield, no
+//  AudioOutputAnalog), this object also keeps the audio library running,
+//  so a sketch like Quad_ADSR does not need a dummy output any more.
+//
+//  Example:
+//      Betweener b;
+//      AudioSynthWaveformDc     dc1;
+//      AudioEffectEnvelope      envelope1;
+//      AudioOutputBetweenerCV   cvOut;
+//      AudioConnection          c1(dc1, envelope1);
+//      AudioConnection          c2(envelope1, 0, cvOut, 0);  //envelope -> CV out 1
+//
+//      void setup(){ b.begin(); AudioMemory(10); cvOut.begin(); ... }
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef BetweenerAudioOutput_h
+#define BetweenerAudioOutput_h
+
+#include <Arduino.h>
+#include <AudioStream.h>
+#include "Betweener.h"
+
+//choices for setMode()
+#define BETWEENER_CV_HOLD 0     //use the first sample of each group
+#define BETWEENER_CV_AVERAGE 1  //use the average of each group
+
+//the fastest write rate we allow: one DAC update per this many samples.
+//Four DAC writes take roughly 20 microseconds, so going faster than
+//this would start to eat a serious share of the processor.
+#define BETWEENER_CV_MIN_SAMPLES_PER_WRITE 8
+
+
+class AudioOutputBetweenerCV : public AudioStream
+{
+    public:
+
+    AudioOutputBetweenerCV(void) : AudioStream(4, inputQueueArray) {}
+
+    //call this in setup(), after Betweener's begin() and AudioMemory().
+    //Returns false if it needed a hardware timer and none was free.
+    bool begin(void);
+
+    //how many audio samples go into each DAC value.  Must be 8, 16, 32, 64
+    //or 128; anything else is rounded down to one of those.  Returns false
+    //if no hardware timer was free.
+    bool setSamplesPerWrite(int samples);
+    void setMode(int mode){ mode_ = mode; };
+    void setBipolar(bool bipolar){ bipolar_ = bipolar; };
+
+    //how often the CV outputs are actually being written, in Hz
+    float writeRate(void);
+
+    //counts of values the timer had to repeat because the audio graph fell
+    //behind, or skip because it ran ahead.  An occasional one is normal
+    //(the audio clock and the timer drift slightly), a steady climb is not.
+    uint32_t underruns(void){ return underruns_; };
+    uint32_t overruns(void){ return overruns_; };
+
+    virtual void update(void);
+
+
+    private:
+
+    //converts one audio sample to a 12-bit DAC code
+    static inline uint16_t sampleToDAC(int32_t sample, bool bipolar){
+        if (bipolar){
+            return (uint16_t)((sample + 32768) >> 4);
+        }
+        if (sample <= 0) return 0;
+        return (uint16_t)(sample >> 3);
+    };
+
+    static void timerISR(void);
+
+    audio_block_t *inputQueueArray[4];
+
+    //this is the only instance the timer talks to.  There are only
+    //four CV outs, so there is no reason to have two of these objects.
+    static AudioOutputBetweenerCV *active_;
+    static bool updateResponsibility_;
+
+    IntervalTimer timer_;
+    volatile int samplesPerWrite_ = AUDIO_BLOCK_SAMPLES;
+    volatile int mode_ = BETWEENER_CV_HOLD;
+    volatile bool bipolar_ = false;
+
+    //ring of DAC codes waiting to be played out by the timer.  It holds
+    //two blocks' worth of values at the fastest rate.
+    static const int RING_FRAMES = 2 * AUDIO_BLOCK_SAMPLES / BETWEENER_CV_MIN_SAMPLES_PER_WRITE;
+    uint16_t ring_[RING_FRAMES][4];
+    volatile uint32_t ringWritten_ = 0;  //frames ever written by update()
+    volatile uint32_t ringRead_ = 0;     //frames ever played by the timer
+    uint32_t ticks_ = 0;                 //timer ticks, for driving the audio library
+
+    volatile uint32_t underruns_ = 0;
+    volatile uint32_t overruns_ = 0;
+};
+
+
+#endif /* BetweenerAudioOutput_h */
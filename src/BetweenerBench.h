@@ -0,0 +1,189 @@
+//
+//  BetweenerBench.h
+//
+//  Copyright (c) 2018 Kathryn Schaffer
+
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////
+//  BetweenerBench.h detailed description:
+//
+//  This file is a small "benchmark harness": code for timing how long
+//  other code takes, used by the sketches in examples/Benchmarks.  They
+//  time the library's functions and a few whole example patches, so that
+//  a change that makes something slower shows up as a number instead of
+//  going unnoticed.
+//
+//  You hand it a name and a piece of code (as a "lambda", the [&]{ ... }
+//  syntax in the examples).  It runs that code in small batches many
+//  times over, timing every batch, and then prints one line of results:
+//      {"bench":"writeCVOut","unit":"cycles","samples":200,"batch":10,
+//       "mean":271.3,"p50":270,"p90":274,"p99":301,"max":355,
+//       "calls_per_sec":353832}
+//  mean and the percentiles are per call: p90 is the time that 90% of
+//  the calls beat, which shows the occasional slow call (an interrupt
+//  that happened to go off, say) that an average hides.  The time it
+//  takes just to read the clock is measured once at the start and taken
+//  off each batch, so the numbers are (very nearly) for your code alone.
+//
+//  On the Teensy the times are processor cycles, counted by the
+//  processor's own cycle counter (96 per microsecond at 96 MHz).  Each
+//  line is "JSON", a format that is easy for other programs to read, so
+//  a whole run can be saved and compared with another one later.
+//
+//  The same file also compiles on a computer (see extras/bench), where
+//  the times are nanoseconds instead.  That is handy for comparing two
+//  versions of some calculation with each other, but the numbers will
+//  not be the same as on the Teensy.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef BetweenerBench_h
+#define BetweenerBench_h
+
+#include <stdio.h>
+#include <stdint.h>
+#if defined(ARDUINO)
+#include <Arduino.h>
+#else
+#include <chrono>
+#endif
+
+#define BETWEENER_BENCH_MAX_SAMPLES 256  //batches timed per benchmark, at most
+
+
+class BetweenerBench
+{
+    public:
+
+#if defined(ARDUINO)
+    BetweenerBench(Print &out = Serial) : out_(out) {}
+#else
+    BetweenerBench(FILE *out = stdout) : out_(out) {}
+#endif
+
+    //starts the cycle counter, works out the cost of reading it, and
+    //prints a first line saying what is being run and on what
+    void begin(const char *suite){
+#if defined(ARDUINO)
+        ARM_DEMCR |= ARM_DEMCR_TRCENA;
+        ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+#endif
+        overhead_ = 0;
+        measure([]{}, 101, 1);
+        overhead_ = sorted_[50];
+        char line[160];
+        snprintf(line, sizeof(line), "{\"suite\":\"%s\",\"unit\":\"%s\",\"cpu_hz\":%lu,\"overhead\":%lu}",
+                 suite, unit(), (unsigned long)cpuHz(), (unsigned long)overhead_);
+        emit(line);
+    }
+
+    //times 'samples' batches of 'batch' calls of fn, and prints the results
+    template<typename F>
+    void run(const char *name, F fn, int samples = 200, int batch = 10){
+        if (samples > BETWEENER_BENCH_MAX_SAMPLES) samples = BETWEENER_BENCH_MAX_SAMPLES;
+        if (samples < 1) samples = 1;
+        if (batch < 1) batch = 1;
+        fn();  //once first, so anything that happens only on the first call is not timed
+        measure(fn, samples, batch);
+
+        uint64_t total = 0;
+        for (int i = 0; i < samples; i++) total += sorted_[i];
+        //per call, in tenths, so no floating point printing is needed
+        const uint32_t mean10 = (uint32_t)(total * 10 / ((uint64_t)samples * batch));
+        const uint64_t calls = (uint64_t)samples * batch;
+        const uint32_t callsPerSec = total ? (uint32_t)(calls * ticksPerSecond() / total) : 0;
+
+        char line[256];
+        snprintf(line, sizeof(line),
+                 "{\"bench\":\"%s\",\"unit\":\"%s\",\"samples\":%d,\"batch\":%d,"
+                 "\"mean\":%lu.%lu,\"p50\":%lu,\"p90\":%lu,\"p99\":%lu,\"max\":%lu,\"calls_per_sec\":%lu}",
+                 name, unit(), samples, batch,
+                 (unsigned long)(mean10 / 10), (unsigned long)(mean10 % 10),
+                 (unsigned long)percentile(samples, batch, 50), (unsigned long)percentile(samples, batch, 90),
+                 (unsigned long)percentile(samples, batch, 99), (unsigned long)(sorted_[samples - 1] / batch),
+                 (unsigned long)callsPerSec);
+        emit(line);
+    }
+
+    //stops the compiler from leaving out a calculation whose result is
+    //never used (which would make it look free)
+    template<typename T>
+    static void keep(const T &value){
+        __asm__ volatile("" : : "r"(&value) : "memory");
+    }
+
+
+    private:
+
+#if defined(ARDUINO)
+    Print &out_;
+    void emit(const char *line){ out_.println(line); }
+    static const char *unit(void){ return "cycles"; }
+    static uint32_t cpuHz(void){ return F_CPU; }
+    static uint64_t ticksPerSecond(void){ return F_CPU; }
+    static inline uint32_t now(void){ return ARM_DWT_CYCCNT; }
+#else
+    FILE *out_;
+    void emit(const char *line){ fputs(line, out_); fputc('\n', out_); fflush(out_); }
+    static const char *unit(void){ return "ns"; }
+    static uint32_t cpuHz(void){ return 0; }
+    static uint64_t ticksPerSecond(void){ return 1000000000ull; }
+    static inline uint32_t now(void){
+        return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+#endif
+
+    //times the batches into sorted_[], minus the empty-batch overhead,
+    //then sorts them (a simple insertion sort: there are only a few hundred)
+    template<typename F>
+    void measure(F fn, int samples, int batch){
+        for (int i = 0; i < samples; i++){
+            const uint32_t start = now();
+            for (int n = 0; n < batch; n++) fn();
+            const uint32_t ticks = now() - start;
+            sorted_[i] = (ticks > overhead_) ? ticks - overhead_ : 0;
+        }
+        for (int i = 1; i < samples; i++){
+            const uint32_t v = sorted_[i];
+            int j = i - 1;
+            while (j >= 0 && sorted_[j] > v){
+                sorted_[j + 1] = sorted_[j];
+                j--;
+            }
+            sorted_[j + 1] = v;
+        }
+    }
+
+    //per-call time that pct percent of the batches beat
+    uint32_t percentile(int samples, int batch, int pct){
+        int i = (samples * pct + 99) / 100 - 1;
+        if (i < 0) i = 0;
+        if (i >= samples) i = samples - 1;
+        return sorted_[i] / batch;
+    }
+
+    uint32_t sorted_[BETWEENER_BENCH_MAX_SAMPLES];
+    uint32_t overhead_ = 0;
+};
+
+
+#endif /* BetweenerBench_h */
@@ -0,0 +1,139 @@
+//
+//  BetweenerBoards.h
+//
+//  Copyright (c) 2018 Kathryn Schaffer
+
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////
+//  BetweenerBoards.h detailed description:
+//
+//  This file describes how a Betweener is wired up: which Teensy pins the
+//  CV inputs, knobs and trigger inputs are on, and which DAC chip and
+//  channel drives each CV output.  Each version of the hardware gets one
+//  "board profile", which is just a table of numbers.
+//
+//  The tables are "constexpr", which means the compiler knows every number
+//  in them while it is compiling.  So when the library looks up, say, the
+//  pin for CV input 1 in the table, the compiler simply puts the pin
+//  number there and the table costs nothing when the sketch runs.  That is
+//  what lets the "template" functions in Betweener.h, like b.readCV<1>(),
+//  turn into a direct analogRead of the right pin.
+//
+//  Picking a profile:
+//  Exactly one profile is used, chosen by BETWEENER_BOARD below.  If you
+//  have a different board revision (or have moved things to other pins),
+//  copy the V1 table, give it a new name, change the numbers, and change
+//  the BETWEENER_BOARD line to point at it.  Like DODINMIDI in
+//  Betweener.h, this is a line you edit in the library itself, because
+//  the library's .cpp files are compiled separately from your sketch and
+//  would not see a #define made in the sketch.
+//
+//  The old names like CVIN1 and CVOUT1_CHIP_SELECT still exist (they are
+//  defined in Betweener.h) and now just read from the chosen profile.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef BetweenerBoards_h
+#define BetweenerBoards_h
+
+#include <Arduino.h>
+
+
+//everything the library needs to know about one version of the hardware.
+//Channel numbers in the sketch go 1-4; in these arrays they go 0-3.
+struct BetweenerBoardProfile {
+    uint8_t cvInPins[4];        //analog pins of CV inputs 1-4
+    uint8_t knobPins[4];        //analog pins of knobs 1-4
+    uint8_t triggerPins[4];     //digital pins of trigger inputs 1-4
+    uint8_t triggerPorts[4];    //the GPIO port each trigger pin is on: 0 = A, 1 = B... 4 = E
+    uint8_t triggerPortBits[4]; //and which bit of that port it is
+    uint8_t cvOutChipSelect[4]; //chip select pin of the DAC for CV outs 1-4
+    uint8_t cvOutDACChannel[4]; //which half (0 or 1) of that DAC
+    uint8_t dacChipSelects[2];  //the chip select pins of the two DACs
+    uint8_t spiMOSI;            //SPI pins used to talk to the DACs
+    uint8_t spiSCK;
+    uint32_t dacSPIClock;       //SPI clock speed for the DACs, in Hz
+    uint8_t adcBits;            //the most bits one ADC conversion can have
+    uint8_t led;                //the front panel LED
+    uint8_t dinMIDIIn;          //Serial2 pins used for DIN MIDI
+    uint8_t dinMIDIOut;
+};
+
+
+namespace BetweenerBoards {
+
+    //The first Betweener, built around a Teensy 3.2.
+    //The MCP4922 DACs are rated for a 20 MHz SPI clock; 4 MHz is what the
+    //library has always used and is known to work with the Audio shield.
+    constexpr BetweenerBoardProfile V1 = {
+        {A7, A6, A3, A2},      //CV inputs
+        {A12, A13, A11, A10},  //knobs
+        {0, 3, 5, 4},          //triggers
+        {1, 0, 3, 0},          //trigger ports: PTB16, PTA12, PTD7, PTA13
+        {16, 12, 7, 13},       //trigger port bits
+        {2, 1, 2, 1},          //CV out DAC chip selects
+        {1, 0, 0, 1},          //CV out DAC channels
+        {1, 2},                //DAC chip selects
+        7,                     //MOSI (the "alternate" MOSI pin on Teensy)
+        14,                    //SCK (also the alternate pin)
+        4000000,               //DAC SPI clock
+        16,                    //ADC bits (about 13 of them are above the noise)
+        8,                     //LED
+        26,                    //DIN MIDI in
+        31,                    //DIN MIDI out
+    };
+
+    //checks that a profile makes sense, so a typo in a new one is caught
+    //by the compiler instead of showing up as a silent output
+    constexpr bool usesDAC(const BetweenerBoardProfile &p, int out){
+        return p.cvOutChipSelect[out] == p.dacChipSelects[0]
+            || p.cvOutChipSelect[out] == p.dacChipSelects[1];
+    }
+    constexpr bool usesTriggerPort(const BetweenerBoardProfile &p, int port){
+        return p.triggerPorts[0] == port || p.triggerPorts[1] == port
+            || p.triggerPorts[2] == port || p.triggerPorts[3] == port;
+    }
+    constexpr bool validTriggerPort(const BetweenerBoardProfile &p, int t){
+        return p.triggerPorts[t] <= 4 && p.triggerPortBits[t] <= 31;
+    }
+    constexpr bool isValid(const BetweenerBoardProfile &p){
+        return usesDAC(p, 0) && usesDAC(p, 1) && usesDAC(p, 2) && usesDAC(p, 3)
+            && p.cvOutDACChannel[0] <= 1 && p.cvOutDACChannel[1] <= 1
+            && p.cvOutDACChannel[2] <= 1 && p.cvOutDACChannel[3] <= 1
+            && p.dacSPIClock > 0 && p.dacSPIClock <= 20000000
+            && p.adcBits >= 10 && p.adcBits <= 16
+            && validTriggerPort(p, 0) && validTriggerPort(p, 1)
+            && validTriggerPort(p, 2) && validTriggerPort(p, 3);
+    }
+}
+
+
+//the profile this library is built for (a build system can also pass
+//-DBETWEENER_BOARD=... to the compiler instead of editing this)
+#ifndef BETWEENER_BOARD
+#define BETWEENER_BOARD BetweenerBoards::V1
+#endif
+
+static_assert(BetweenerBoards::isValid(BETWEENER_BOARD),
+              "the Betweener board profile has a CV out on a DAC that does not exist, an impossible SPI clock or ADC resolution, or a trigger on a port that does not exist");
+
+
+#endif /* BetweenerBoards_h */
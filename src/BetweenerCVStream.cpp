@@ -0,0 +1,375 @@
+//
+//  BetweenerCVStream.cpp
+//
+//  Copyright (c) 2018 Kathryn Schaffer
+
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+//  BetweenerCVStream.cpp detailed description:
+//
+//  Implementation of BetweenerCVStream.  See BetweenerCVStream.h for the
+//  packet layouts and how to use it.
+//
+//  The jitter buffer is a ring of block slots with two free-running
+//  counters, like BetweenerTelemetry's queue: update() (in loop) is the
+//  only one that moves blocksIn_ and the timer is the only one that moves
+//  blocksOut_, so neither needs to turn interrupts off to hand over a
+//  block.  Sample numbers are compared as (int32_t)(a - b), so they can
+//  wrap around without trouble.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "BetweenerCVStream.h"
+
+BetweenerCVStream * BetweenerCVStream::active_ = NULL;
+
+
+static inline uint16_t get16(const uint8_t *p){
+    return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t get32(const uint8_t *p){
+    return p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint8_t *put16(uint8_t *p, uint16_t v){
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+    return p + 2;
+}
+
+static inline uint8_t *put32(uint8_t *p, uint32_t v){
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+    return p + 4;
+}
+
+
+bool BetweenerCVStream::begin(float samplesPerSecond, int latencyFrames){
+    active_ = this;
+    setLatency(latencyFrames);
+    reset();
+    resetStats();
+    if (samplesPerSecond <= 0){
+        DEBUG_PRINTLN("the CV stream needs a positive sample rate!");
+        return false;
+    }
+    Betweener::shareDACWithTimers();
+    if (!timer_.begin(timerISR, (float)(1000000.0 / samplesPerSecond))){
+        DEBUG_PRINTLN("the CV stream: all the hardware timers (IntervalTimers) are in use!");
+        return false;
+    }
+    return true;
+}
+
+
+void BetweenerCVStream::end(void){
+    timer_.end();
+}
+
+
+void BetweenerCVStream::setLatency(int latencyFrames){
+    //the playhead has to be able to wait that long with the buffer holding
+    //it, plus a block's worth of room to receive the next one
+    const int most = (BETWEENER_STREAM_BLOCKS - 1) * BETWEENER_STREAM_MAX_FRAMES;
+    if (latencyFrames < 0 || latencyFrames > most){
+        DEBUG_PRINTLN("CV stream latency is out of range; using the nearest allowed");
+    }
+    latency_ = constrain(latencyFrames, 0, most);
+}
+
+
+void BetweenerCVStream::reset(void){
+    __disable_irq();
+    blocksOut_ = blocksIn_;
+    started_ = false;
+    end_ = playhead_;
+    __enable_irq();
+}
+
+
+void BetweenerCVStream::resetStats(void){
+    minFill_ = 0xFFFF;
+    blocksAccepted_ = 0;
+    lateBlocks_ = 0;
+    lateFrames_ = 0;
+    underruns_ = 0;
+    badPackets_ = 0;
+    overflows_ = 0;
+}
+
+
+int BetweenerCVStream::fill(void){
+    if (!started_) return 0;
+    const int32_t ahead = (int32_t)(end_ - playhead_);
+    return ahead > 0 ? ahead : 0;
+}
+
+
+void BetweenerCVStream::update(void){
+    receive();
+    if (millis() - lastStatus_ >= statusMillis_){
+        lastStatus_ = millis();
+        sendStatus();
+    }
+}
+
+
+void BetweenerCVStream::receive(void){
+    //only read while there is a free slot to read into.  Otherwise the
+    //bytes stay in USB, which makes the computer wait.
+    while (blocksIn_ - blocksOut_ < BETWEENER_STREAM_BLOCKS){
+        uint8_t *p = slots_[blocksIn_ % BETWEENER_STREAM_BLOCKS];
+        const int available = port_.available();
+        if (available <= 0) return;
+
+        //the 4 header bytes come one at a time, so that after a lost byte
+        //we find the next sync as soon as possible
+        if (rxPos_ < 4){
+            p[rxPos_++] = port_.read();
+            if (rxPos_ == 1 && p[0] != BETWEENER_STREAM_SYNC1){
+                rxPos_ = 0;
+            }else if (rxPos_ == 2 && p[1] != BETWEENER_STREAM_SYNC2){
+                rxPos_ = (p[1] == BETWEENER_STREAM_SYNC1) ? 1 : 0;
+            }else if (rxPos_ == 4){
+                const uint8_t type = p[2];
+                const uint8_t length = p[3];
+                const bool blockOK = (type == BETWEENER_STREAM_BLOCK && length >= 7 + 6
+                                      && length <= 7 + 6 * BETWEENER_STREAM_MAX_FRAMES
+                                      && (length - 7) % 6 == 0);
+                const bool resetOK = (type == BETWEENER_STREAM_RESET && length == 0);
+                if (!blockOK && !resetOK){
+                    badPackets_++;
+                    rxPos_ = 0;
+                }
+            }
+            continue;
+        }
+
+        //the rest goes straight into the slot, as much as has arrived
+        const int total = 4 + p[3] + 2;
+        const int wanted = min(available, total - rxPos_);
+        rxPos_ += port_.readBytes(p + rxPos_, wanted);
+        if (rxPos_ < total) return;
+        rxPos_ = 0;
+
+        const uint16_t sum = BetweenerMath::fletcher16(p + 2, p + total - 2);
+        if (get16(p + total - 2) != sum){
+            badPackets_++;
+            continue;
+        }
+        packetReceived(p);
+    }
+}
+
+
+void BetweenerCVStream::packetReceived(uint8_t *packet){
+    if (packet[2] == BETWEENER_STREAM_RESET){
+        reset();
+        resetStats();
+        return;
+    }
+    //the sample count has to agree with the length
+    if (packet[10] != (packet[3] - 7) / 6){
+        badPackets_++;
+        return;
+    }
+    accept(packet);
+}
+
+
+void BetweenerCVStream::accept(uint8_t *block){
+    const uint32_t start = get32(block + 6);
+    const uint8_t count = block[10];
+
+    if (!started_){
+        //the first block of a stream: start the playhead 'latency' samples
+        //before it.  The timer must not tick in between these.
+        __disable_irq();
+        playhead_ = start - latency_;
+        end_ = start + count;
+        minFill_ = 0xFFFF;
+        started_ = true;
+        blocksIn_ = blocksIn_ + 1;
+        __enable_irq();
+    }else{
+        const uint32_t now = playhead_;
+        //too late to play any of it, or behind what is already buffered
+        if ((int32_t)(start + count - now) <= 0 || (int32_t)(start - end_) < 0){
+            lateBlocks_++;
+            return;
+        }
+        //partly late: the timer skips the samples already due
+        if ((int32_t)(now - start) > 0) lateFrames_ += now - start;
+        end_ = start + count;
+        blocksIn_ = blocksIn_ + 1;
+    }
+    lastSeq_ = get16(block + 4);
+    blocksAccepted_++;
+}
+
+
+bool BetweenerCVStream::handleSysEx(const uint8_t *data, unsigned int length){
+    //skip the F0 / F7 framing if it is there
+    if (length > 0 && data[0] == 0xF0){ data++; length--; }
+    if (length > 0 && data[length - 1] == 0xF7){ length--; }
+
+    if (length < 3 || data[0] != BETWEENER_SYSEX_ID || data[1] != BETWEENER_SYSEX_CVSTREAM){
+        return false;
+    }
+    const uint8_t command = data[2];
+    const uint8_t *args = data + 3;
+    const unsigned int nargs = length - 3;
+
+    if (command == BETWEENER_STREAM_RESET){
+        reset();
+        resetStats();
+        return true;
+    }
+    if (command != BETWEENER_STREAM_BLOCK || nargs < 8) return false;
+    const unsigned int count = args[7];
+    if (count < 1 || count > BETWEENER_STREAM_MAX_FRAMES || nargs != 8 + 8 * count){
+        badPackets_++;
+        return true;
+    }
+    sysExReports_ = true;
+
+    //MIDI cannot wait like serial can: with no free slot, the block is lost
+    if (blocksIn_ - blocksOut_ >= BETWEENER_STREAM_BLOCKS){
+        overflows_++;
+        return true;
+    }
+
+    //unpack the 7-bit bytes straight into the free slot, in the same
+    //layout a serial block has, so the timer does not know the difference
+    uint8_t *p = slots_[blocksIn_ % BETWEENER_STREAM_BLOCKS];
+    uint32_t timestamp = 0;
+    for (int i = 4; i >= 0; i--){
+        timestamp = (timestamp << 7) | (args[2 + i] & 0x7F);
+    }
+    p[2] = BETWEENER_STREAM_BLOCK;
+    p[3] = 7 + 6 * count;
+    put16(p + 4, (args[0] & 0x7F) | ((args[1] & 0x7F) << 7));
+    put32(p + 6, timestamp);
+    p[10] = count;
+
+    const uint8_t *in = args + 8;
+    uint8_t *out = p + 11;
+    for (unsigned int f = 0; f < count * 2; f++){
+        //two outputs at a time make 3 bytes
+        const uint16_t a = (in[0] & 0x7F) | ((in[1] & 0x1F) << 7);
+        const uint16_t b = (in[2] & 0x7F) | ((in[3] & 0x1F) << 7);
+        out[0] = a & 0xFF;
+        out[1] = (a >> 8) | ((b & 0x0F) << 4);
+        out[2] = b >> 4;
+        in += 4;
+        out += 3;
+    }
+    accept(p);
+    return true;
+}
+
+
+void BetweenerCVStream::sendStatus(void){
+    uint8_t frame[BETWEENER_STREAM_STATUS_SIZE];
+    uint8_t *p = frame;
+    *p++ = BETWEENER_STREAM_SYNC1;
+    *p++ = BETWEENER_STREAM_SYNC2;
+    *p++ = BETWEENER_STREAM_STATUS;
+    *p++ = BETWEENER_STREAM_STATUS_SIZE - 6;
+    p = put16(p, lastSeq_);
+    p = put32(p, playhead_);
+    p = put16(p, fill());
+    const uint16_t lowest = minFill_;
+    minFill_ = 0xFFFF;
+    p = put16(p, lowest == 0xFFFF ? fill() : lowest);
+    *p++ = BETWEENER_STREAM_BLOCKS - (blocksIn_ - blocksOut_);
+    p = put32(p, blocksAccepted_);
+    p = put32(p, lateBlocks_);
+    p = put32(p, lateFrames_);
+    p = put32(p, underruns_);
+    p = put32(p, badPackets_);
+    p = put32(p, overflows_);
+    p = put16(p, BetweenerMath::fletcher16(frame + 2, p));
+
+#if BETWEENER_USE_USB_MIDI
+    if (sysExReports_){
+        uint8_t sysex[3 + 2 * (BETWEENER_STREAM_STATUS_SIZE - 6)];
+        sysex[0] = BETWEENER_SYSEX_ID;
+        sysex[1] = BETWEENER_SYSEX_CVSTREAM;
+        sysex[2] = BETWEENER_STREAM_STATUS;
+        for (int i = 0; i < BETWEENER_STREAM_STATUS_SIZE - 6; i++){
+            sysex[3 + 2 * i] = frame[4 + i] & 0x0F;
+            sysex[4 + 2 * i] = frame[4 + i] >> 4;
+        }
+        usbMIDI.sendSysEx(sizeof(sysex), sysex);
+        return;
+    }
+#endif
+    //whole frames only, and never wait for the port
+    if (port_.availableForWrite() >= BETWEENER_STREAM_STATUS_SIZE){
+        port_.write(frame, BETWEENER_STREAM_STATUS_SIZE);
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////
+//Everything below here runs inside the timer interrupt.
+
+void BetweenerCVStream::tick(void){
+    if (!started_) return;
+    const uint32_t now = playhead_;
+
+    while (blocksOut_ != blocksIn_){
+        const uint8_t *block = slots_[blocksOut_ % BETWEENER_STREAM_BLOCKS];
+        const int32_t offset = (int32_t)(now - get32(block + 6));
+        const int count = block[10];
+
+        //the next block starts later (the computer left a gap): hold
+        if (offset < 0) break;
+
+        //all of it has been played, or its time has passed
+        if (offset >= count){
+            blocksOut_ = blocksOut_ + 1;
+            continue;
+        }
+
+        const uint8_t *s = block + 11 + 6 * offset;
+        Betweener::writeCVOut<1>(s[0] | ((s[1] & 0x0F) << 8));
+        Betweener::writeCVOut<2>((s[1] >> 4) | (s[2] << 4));
+        Betweener::writeCVOut<3>(s[3] | ((s[4] & 0x0F) << 8));
+        Betweener::writeCVOut<4>((s[4] >> 4) | (s[5] << 4));
+        if (offset + 1 == count) blocksOut_ = blocksOut_ + 1;
+        break;
+    }
+    //nothing was due because the buffer ran dry: the outputs hold
+    if ((int32_t)(end_ - now) <= 0) underruns_++;
+
+    playhead_ = now + 1;
+    const int32_t ahead = (int32_t)(end_ - playhead_);
+    const uint16_t f = ahead > 0 ? ahead : 0;
+    if (f < minFill_) minFill_ = f;
+}
+
+
+void BetweenerCVStream::timerISR(void){
+    if (active_) active_->tick();
+}
@@ -0,0 +1,205 @@
+//
+//  BetweenerCVStream.h
+//
+//  Copyright (c) 2018 Kathryn Schaffer
+
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////
+//  BetweenerCVStream.h detailed description:
+//
+//  This file defines BetweenerCVStream, which turns the Betweener into a
+//  four channel "USB DAC": a computer (e.g. a DAW's automation, or the
+//  Python program in extras/stream) sends blocks of 12-bit samples for the
+//  four CV outs, and the Betweener plays them out at a steady rate.
+//
+//  Sending automation as MIDI CCs and converting them with MIDItoCV() gives
+//  only 128 steps, and every value costs a whole MIDI message.  Here each
+//  sample is the full 0-4095 DAC range, and four of them pack into 6 bytes.
+//
+//  USB delivers the blocks in bursts, never exactly on time, so they are
+//  not played as they arrive.  Each block carries a "timestamp": the
+//  sample number of its first sample, counting from the start of the
+//  stream.  Blocks wait in a "jitter buffer" and a hardware timer plays one
+//  sample per tick, always the one whose number matches the playhead.  The
+//  playhead starts "latency" samples behind the first block received, so
+//  there is that much slack to absorb late deliveries.  If the buffer runs
+//  dry, the outputs hold their last value; if a block arrives after its
+//  time has passed, the late part is skipped so everything after it is
+//  still played at the right moment.
+//
+//  The bytes are read from USB straight into the slot of the jitter buffer
+//  where they will be played from, and the timer unpacks each sample from
+//  there, so no block is ever copied.
+//
+//  Every 20 ms (see setStatusInterval) a status frame goes back to the
+//  computer with how full the buffer is and what went wrong, so it can
+//  send faster or slower.  The program in extras/stream paces itself this
+//  way, which also takes care of the computer's clock and the Teensy's
+//  running at very slightly different speeds.
+//
+//  Packets, little-endian, all starting like BetweenerTelemetry frames:
+//      offset  size  contents
+//       0      2     sync bytes 0xA5 0x5A
+//       2      1     type
+//       3      1     payload length (from offset 4 up to the checksum)
+//       4      ...   payload
+//       ...    2     Fletcher-16 checksum of everything from offset 2
+//
+//  Computer to Betweener, type 0x10, a block of samples:
+//       4      2     sequence number (reported back in the status)
+//       6      4     timestamp: the sample number of the first sample
+//      10      1     number of samples n, 1 to BETWEENER_STREAM_MAX_FRAMES
+//      11      6n    the samples.  Each set of four outputs is 6 bytes:
+//                    out1 bits 0-7, out1 bits 8-11 + out2 bits 0-3 << 4,
+//                    out2 bits 4-11, then the same for outs 3 and 4.
+//  Computer to Betweener, type 0x12, reset: no payload.  Empties the
+//  buffer, zeroes the statistics; the next block starts a new stream.
+//
+//  Betweener to computer, type 0x11, status (41 bytes in all):
+//       4      2     sequence number of the last block accepted
+//       6      4     playhead: the number of the next sample to play
+//      10      2     fill: samples buffered ahead of the playhead
+//      12      2     lowest fill since the last status
+//      14      1     free block slots
+//      15      4     blocks accepted
+//      19      4     late blocks: arrived after their last sample's time
+//                    (or out of order) and were thrown away
+//      23      4     late samples: the skipped parts of partly late blocks
+//      27      4     underruns: timer ticks with nothing to play
+//      31      4     bad packets: wrong checksum, length or type
+//      35      4     blocks lost because the buffer was full (SysEx only;
+//                    over serial the computer is simply made to wait)
+//
+//  SysEx fallback, for hosts that can only send MIDI.  Pass each SysEx
+//  message to handleSysEx().  After the F0 come 0x7D, 0x43 (see
+//  BETWEENER_SYSEX_ID in BetweenerSequencer.h), a command, and 7-bit data:
+//      0x10  block: sequence number (2 bytes, 7 bits each, lowest first),
+//            timestamp (5 bytes, the same way), n, then for each sample
+//            and output, bits 0-6 and bits 7-11.  At most 269 bytes, which
+//            fits the Teensy's usbMIDI SysEx buffer.
+//      0x12  reset
+//  Use either serial or SysEx for a stream, not both at once.  Once a
+//  block has come by SysEx, the status goes back by usbMIDI as
+//  F0 7D 43 11 followed by the 35 status payload bytes, each sent as two
+//  4-bit halves (lowest first), then F7.
+//
+//  Example:
+//      Betweener b;
+//      BetweenerCVStream stream;
+//      void setup(){ b.begin(); stream.begin(1000, 64); }  //1 kHz, 64 ms slack
+//      void loop(){ stream.update(); }
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef BetweenerCVStream_h
+#define BetweenerCVStream_h
+
+#include <Arduino.h>
+#include "Betweener.h"
+#include "BetweenerSequencer.h"  //for BETWEENER_SYSEX_ID
+
+#define BETWEENER_STREAM_BLOCKS 16      //jitter buffer slots; a power of two
+#define BETWEENER_STREAM_MAX_FRAMES 32  //samples (of all four outs) per block
+#define BETWEENER_STREAM_SYNC1 0xA5
+#define BETWEENER_STREAM_SYNC2 0x5A
+#define BETWEENER_STREAM_BLOCK 0x10     //packet types
+#define BETWEENER_STREAM_STATUS 0x11
+#define BETWEENER_STREAM_RESET 0x12
+#define BETWEENER_STREAM_STATUS_SIZE 41
+#define BETWEENER_SYSEX_CVSTREAM 0x43
+
+
+class BetweenerCVStream
+{
+    public:
+
+    BetweenerCVStream(Stream &port = Serial) : port_(port) {}
+
+    //start the playout timer.  latencyFrames is how many samples behind
+    //the first block the playhead starts, e.g. 64 at 1 kHz is 64 ms.
+    //Returns false if no hardware timer was free.
+    bool begin(float samplesPerSecond = 1000, int latencyFrames = 64);
+    void end(void);
+    void setLatency(int latencyFrames);  //takes effect at the next reset
+    void setStatusInterval(uint32_t millisec){ statusMillis_ = millisec; };
+
+    //reads whatever packets have arrived and sends the status when it is
+    //due.  Call it from loop() as often as you can.  Never waits.
+    void update(void);
+
+    //for the SysEx fallback, e.g. from usbMIDI.setHandleSystemExclusive.
+    //Returns false if the message was not for the stream.
+    bool handleSysEx(const uint8_t *data, unsigned int length);
+
+    //empty the buffer and wait for a new stream; the outputs hold
+    void reset(void);
+    void resetStats(void);
+
+    bool playing(void){ return started_; };
+    uint32_t playhead(void){ return playhead_; };
+    int fill(void);  //samples buffered ahead of the playhead
+    uint32_t blocksAccepted(void){ return blocksAccepted_; };
+    uint32_t lateBlocks(void){ return lateBlocks_; };
+    uint32_t lateFrames(void){ return lateFrames_; };
+    uint32_t underruns(void){ return underruns_; };
+    uint32_t badPackets(void){ return badPackets_; };
+    uint32_t overflows(void){ return overflows_; };
+
+
+    private:
+
+    void receive(void);
+    void packetReceived(uint8_t *packet);
+    void accept(uint8_t *block);
+    void sendStatus(void);
+    void tick(void);
+    static void timerISR(void);
+    static BetweenerCVStream *active_;
+
+    Stream &port_;
+    IntervalTimer timer_;
+
+    //each slot holds one block packet exactly as it arrived
+    uint8_t slots_[BETWEENER_STREAM_BLOCKS][11 + 6 * BETWEENER_STREAM_MAX_FRAMES + 2];
+    volatile uint32_t blocksIn_ = 0;   //blocks ever put in the buffer
+    volatile uint32_t blocksOut_ = 0;  //blocks ever finished with by the timer
+    int rxPos_ = 0;                    //bytes of the next packet received so far
+
+    volatile bool started_ = false;
+    volatile uint32_t playhead_ = 0;   //sample number the timer plays next
+    volatile uint32_t end_ = 0;        //sample number just after the last one buffered
+    uint32_t latency_ = 64;
+    uint16_t lastSeq_ = 0;
+
+    uint32_t statusMillis_ = 20;
+    uint32_t lastStatus_ = 0;
+    bool sysExReports_ = false;
+
+    volatile uint16_t minFill_ = 0xFFFF;
+    volatile uint32_t blocksAccepted_ = 0;
+    volatile uint32_t lateBlocks_ = 0;
+    volatile uint32_t lateFrames_ = 0;
+    volatile uint32_t underruns_ = 0;
+    volatile uint32_t badPackets_ = 0;
+    volatile uint32_t overflows_ = 0;
+};
+
+
+#endif /* BetweenerCVStream_h */
@@ -0,0 +1,154 @@
+//
+//  BetweenerConfig.h
+//
+//  Copyright (c) 2018 Kathryn Schaffer
+
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////
+//  BetweenerConfig.h detailed description:
+//
+//  This file chooses which parts of the Betweener library get built.
+//
+//  Out of the box everything is in: the CV and knob inputs with their
+//  smoothing, the trigger inputs with a Bounce object each, and USB MIDI.
+//  A sketch that only uses some of them still pays for all of them.  Every
+//  Betweener object carries eight smoothing objects, four Bounce objects
+//  and the names for all sixteen readings, and begin() sets every part up,
+//  which pulls their code into the sketch.  That is memory the Audio
+//  library could be using for its buffers (the Teensy 3.2 has 64 KB).
+//
+//  Each line below turns one part on (1) or off (0).  Like DODINMIDI, the
+//  switches have to be set here, in the library, rather than in your
+//  sketch: the library's .cpp files are compiled separately and would not
+//  see a #define made in the sketch.  A build system (or arduino-cli, see
+//  extras/size/size_report.py) can also pass them to the compiler, e.g.
+//  -DBETWEENER_USE_SMOOTHING=0, without anything being edited, because
+//  then every file gets the same value.
+//
+//  Setting them with a #define in the sketch is NOT supported.  Most of
+//  the switches add or remove parts of the Betweener object (and
+//  BETWEENER_RANDOM_XORSHIFT changes BetweenerRandom's), so the sketch
+//  and the library would disagree about where everything in it is, and
+//  would quietly overwrite each other's memory.  To stop that ever
+//  getting as far as the Teensy, the settings are built into the name of
+//  a symbol (BETWEENER_CONFIG_CHECK below) that the library defines and
+//  the Betweener constructor uses.  If they differ, the build stops with
+//  an error like
+//      undefined reference to `betweenerConfig_11011100'
+//  and the fix is to take the #defines out of the sketch and set them
+//  here instead.
+//
+//  Turning a part off removes its functions too, so a sketch that still
+//  uses one (say, readCV() with BETWEENER_USE_ANALOG_INPUTS 0) will not
+//  compile, rather than quietly reading nothing.  The CV outs, pulses,
+//  the ADC settings and getInputs() are always there.
+//
+//  To see what each choice saves, run the Hardware Tests example
+//  E_Footprint_Report, or extras/size/size_report.py for the full table.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef BetweenerConfig_h
+#define BetweenerConfig_h
+
+//the CV inputs and knobs: readCVs(), readCV(), readKnob(), CVChanged()...
+//and currentCV(), lastKnob() and so on
+#ifndef BETWEENER_USE_ANALOG_INPUTS
+#define BETWEENER_USE_ANALOG_INPUTS 1
+#endif
+
+//the older names for the readings, b.currentCV1 ... b.lastKnob4.  The
+//functions b.currentCV(1) ... b.lastKnob(4) read the same values for free;
+//the names cost 64 bytes of RAM in every Betweener object.  On by default
+//so that older sketches still compile.
+#ifndef BETWEENER_USE_LEGACY_NAMES
+#define BETWEENER_USE_LEGACY_NAMES 1
+#endif
+
+//smoothing of those inputs with the ResponsiveAnalogRead library.  With
+//it off, readCV() and readKnob() give the same as readCVRaw() and
+//readKnobRaw(), and CVChanged() / knobChanged() are true when a new
+//reading is further than the activity threshold from the last readCV()
+//or readKnob().
+#ifndef BETWEENER_USE_SMOOTHING
+#define BETWEENER_USE_SMOOTHING 1
+#endif
+
+//the trigger inputs: readTriggers(), triggerRose() and the others
+#ifndef BETWEENER_USE_TRIGGERS
+#define BETWEENER_USE_TRIGGERS 1
+#endif
+
+//the Bounce objects b.trig1 ... b.trig4.  With them off, the triggers are
+//always read by the fast front end (see useFastTriggers in Betweener.h).
+#ifndef BETWEENER_USE_BOUNCE
+#define BETWEENER_USE_BOUNCE 1
+#endif
+
+//readUsbMIDI(), also called by readAllInputs().  The Teensy only has
+//usbMIDI when "USB Type" in the Tools menu includes MIDI.
+#ifndef BETWEENER_USE_USB_MIDI
+#define BETWEENER_USE_USB_MIDI 1
+#endif
+
+//the generator behind BetweenerRandom: 0 for PCG32 (the better
+//randomness), 1 for xorshift32 (a little quicker and smaller on the Teensy)
+#ifndef BETWEENER_RANDOM_XORSHIFT
+#define BETWEENER_RANDOM_XORSHIFT 0
+#endif
+
+//5-pin DIN MIDI.  If you want it, uncomment the line that says
+//#define DODINMIDI.  Otherwise, leave it commented out.
+//Note that if you use MIDI DIN, you will need
+//the updated MIDI library for Teensy, from here:
+//https://github.com/FortySevenEffects/arduino_midi_library
+//and you will need to delete the default MIDI.h file that
+//is included in the Arduino package.
+//#define DODINMIDI
+
+
+//smoothing and Bounce only make sense with what they belong to
+#if BETWEENER_USE_SMOOTHING && !BETWEENER_USE_ANALOG_INPUTS
+#undef BETWEENER_USE_SMOOTHING
+#define BETWEENER_USE_SMOOTHING 0
+#endif
+#if BETWEENER_USE_BOUNCE && !BETWEENER_USE_TRIGGERS
+#undef BETWEENER_USE_BOUNCE
+#define BETWEENER_USE_BOUNCE 0
+#endif
+
+
+//the settings that change the library's objects, as one name, e.g.
+//betweenerConfig_11111100 (the last two digits are DODINMIDI and
+//BETWEENER_RANDOM_XORSHIFT).  The values have to be plain 0 or 1 for the
+//name to come out right.
+#ifdef DODINMIDI
+#define BETWEENER_CONFIG_DIN_MIDI 1
+#else
+#define BETWEENER_CONFIG_DIN_MIDI 0
+#endif
+#define BETWEENER_CONFIG_PASTE(a, b, c, d, e, f, g, h) betweenerConfig_ ## a ## b ## c ## d ## e ## f ## g ## h
+#define BETWEENER_CONFIG_NAME(a, b, c, d, e, f, g, h) BETWEENER_CONFIG_PASTE(a, b, c, d, e, f, g, h)
+#define BETWEENER_CONFIG_CHECK BETWEENER_CONFIG_NAME(BETWEENER_USE_ANALOG_INPUTS, \
+    BETWEENER_USE_LEGACY_NAMES, BETWEENER_USE_SMOOTHING, BETWEENER_USE_TRIGGERS, \
+    BETWEENER_USE_BOUNCE, BETWEENER_USE_USB_MIDI, BETWEENER_CONFIG_DIN_MIDI, BETWEENER_RANDOM_XORSHIFT)
+
+
+#endif /* BetweenerConfig_h */
@@ -0,0 +1,218 @@
+//
+//  BetweenerIdle.cpp
+//
+//  Copyright (c) 2018 Kathryn Schaffer
+
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+//  BetweenerIdle.cpp detailed description:
+//
+//  Implementation of BetweenerIdle.  See BetweenerIdle.h for how to use it.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "BetweenerIdle.h"
+
+uint8_t BetweenerIdle::triggerMask_ = 0;
+volatile bool BetweenerIdle::pending_ = false;
+volatile uint32_t BetweenerIdle::eventCycles_ = 0;
+uint64_t BetweenerIdle::slept_ = 0;
+uint64_t BetweenerIdle::total_ = 0;
+uint32_t BetweenerIdle::statsLast_ = 0;
+uint32_t BetweenerIdle::wakeups_ = 0;
+uint32_t BetweenerIdle::eventWakeups_ = 0;
+uint32_t BetweenerIdle::latencyLast_ = 0;
+uint32_t BetweenerIdle::latencyMax_ = 0;
+
+
+#if defined(KINETISK)
+//micros() the way the Teensy 3 works it out, but without turning
+//interrupts back on, so idle() can note the time the moment WFI ends,
+//before the interrupt that woke it runs.  The 1 ms tick (SysTick) counts
+//down from F_CPU / 1000 - 1 to 0 once every millisecond.
+static inline uint32_t microsNow(void){
+    uint32_t count = systick_millis_count;
+    const uint32_t current = SYST_CVR;
+    //a tick that has happened but whose interrupt has not run yet
+    if ((SCB_ICSR & SCB_ICSR_PENDSTSET) && current > 50) count++;
+    return count * 1000 + ((F_CPU / 1000 - 1) - current) / (F_CPU / 1000000);
+}
+
+//how long until the next 1 ms tick, in microseconds
+static inline uint32_t microsToNextTick(void){
+    return SYST_CVR / (F_CPU / 1000000);
+}
+#endif
+
+
+void BetweenerIdle::begin(uint8_t triggerMask){
+    //the cycle counter, for the wake latency
+    ARM_DEMCR |= ARM_DEMCR_TRCENA;
+    ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+
+    end();
+    triggerMask_ = triggerMask & 0x0F;
+    void (*isrs[4])(void) = {triggerISR1, triggerISR2, triggerISR3, triggerISR4};
+    for (int i = 0; i < 4; i++){
+        if (triggerMask_ & (1 << i)){
+            attachInterrupt(BETWEENER_BOARD.triggerPins[i], isrs[i], CHANGE);
+        }
+    }
+    resetStats();
+}
+
+
+void BetweenerIdle::end(void){
+    for (int i = 0; i < 4; i++){
+        if (triggerMask_ & (1 << i)){
+            detachInterrupt(BETWEENER_BOARD.triggerPins[i]);
+        }
+    }
+    triggerMask_ = 0;
+}
+
+
+bool BetweenerIdle::idle(uint32_t maxMicros){
+    //let the Teensy do its own housekeeping first (this is also where
+    //BetweenerLog prints what it has recorded)
+    yield();
+
+    const uint32_t start = micros();
+    for (;;){
+        if (pending_){
+            pending_ = false;
+            wakeups_++;
+            eventWakeups_++;
+            return true;
+        }
+        const uint32_t waited = micros() - start;
+        if (waited >= maxMicros){
+            wakeups_++;
+            return false;
+        }
+
+        //Nothing wakes the processor when maxMicros is up: usually the
+        //next interrupt is the 1 ms tick.  So if the time left ends before
+        //that tick, stay awake and keep checking instead of sleeping past
+        //it (idle(200) should not take a whole millisecond).
+#if defined(KINETISK)
+        if (maxMicros - waited < microsToNextTick()) continue;
+#else
+        if (maxMicros - waited < 1000) continue;
+#endif
+
+        const uint32_t tick = millis();
+#if defined(KINETISK)
+        __disable_irq();
+        const uint32_t before = microsNow();
+#else
+        const uint32_t before = micros();  //(micros() turns interrupts back on, so read it first)
+        __disable_irq();
+#endif
+        //checked again with interrupts off: an event that came in since the
+        //check above would otherwise be missed until the next wake-up
+        if (!pending_){
+#if defined(__arm__)
+            //with interrupts off, WFI still wakes on an interrupt, but the
+            //interrupt only runs once we turn them back on just below
+            __asm__ volatile("wfi");
+#endif
+        }
+#if defined(KINETISK)
+        //stop the sleep clock before the waking interrupt runs, so the
+        //time spent in it counts as awake
+        const uint32_t after = microsNow();
+        __enable_irq();
+#else
+        __enable_irq();
+        const uint32_t after = micros();
+#endif
+        slept_ += after - before;
+        countTime();
+
+        if (pending_){
+            //how long from the event interrupt to here
+            const uint32_t latency = ARM_DWT_CYCCNT - eventCycles_;
+            latencyLast_ = latency;
+            if (latency > latencyMax_) latencyMax_ = latency;
+            continue;  //reported at the top of the loop
+        }
+        //woken, but not by the 1 ms clock tick alone: some other interrupt
+        //(USB, a timer...) may have left work for loop()
+        if (millis() == tick){
+            wakeups_++;
+            return false;
+        }
+    }
+}
+
+
+void BetweenerIdle::markEvent(void){
+    //only the first event since loop() last looked counts for the latency
+    if (!pending_){
+        eventCycles_ = ARM_DWT_CYCCNT;
+        pending_ = true;
+    }
+}
+
+
+uint64_t BetweenerIdle::sleptMicros(void){
+    return slept_;
+}
+
+
+void BetweenerIdle::countTime(void){
+    //keep a 64 bit running total, so the times still add up after
+    //micros() wraps around (every 71 minutes)
+    const uint32_t now = micros();
+    total_ += now - statsLast_;
+    statsLast_ = now;
+}
+
+
+uint64_t BetweenerIdle::awakeMicros(void){
+    countTime();
+    return (total_ > slept_) ? total_ - slept_ : 0;
+}
+
+
+float BetweenerIdle::sleepFraction(void){
+    const uint64_t awake = awakeMicros();
+    const uint64_t all = awake + slept_;
+    if (all == 0) return 0;
+    return (float)((double)slept_ / (double)all);
+}
+
+
+void BetweenerIdle::resetStats(void){
+    statsLast_ = micros();
+    total_ = 0;
+    slept_ = 0;
+    wakeups_ = 0;
+    eventWakeups_ = 0;
+    latencyLast_ = 0;
+    latencyMax_ = 0;
+}
+
+
+void BetweenerIdle::triggerISR1(void){ markEvent(); }
+void BetweenerIdle::triggerISR2(void){ markEvent(); }
+void BetweenerIdle::triggerISR3(void){ markEvent(); }
+void BetweenerIdle::triggerISR4(void){ markEvent(); }
@@ -0,0 +1,134 @@
+//
+//  BetweenerIdle.h
+//
+//  Copyright (c) 2018 Kathryn Schaffer
+
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////
+//  BetweenerIdle.h detailed description:
+//
+//  This file defines BetweenerIdle, which lets the Teensy nap when your
+//  sketch has nothing to do.
+//
+//  Most sketches run loop() as fast as they can, reading every input
+//  over and over even when nothing has changed.  That keeps the processor
+//  busy all the time, which uses more power (it matters when the Betweener
+//  runs from a USB port) and makes electrical noise that ends up in the
+//  CV and knob readings.  Calling BetweenerIdle::idle() at the end of
+//  loop() instead puts the processor to sleep ("WFI", wait for interrupt)
+//  until something happens:
+//    - a trigger input changes (if you asked for that in begin())
+//    - a USB message arrives (USB MIDI, serial...)
+//    - any timer or other interrupt goes off, like the library's own
+//      pulse timer, the sequencer, the audio library, or the ADC
+//    - or the longest sleep you allowed has passed
+//  and then returns, so loop() can deal with it.  There is no timer for
+//  that last one: the processor sleeps until the next 1 ms clock tick at
+//  most, and when the time left is shorter than that, idle() stays awake
+//  and watches the clock instead.  So idle(200) returns after 200
+//  microseconds, not at the next tick.  Interrupts (timers,
+//  audio...) keep running normally while loop() sleeps.
+//
+//  The Teensy's 1 ms clock tick (the one that counts millis()) also wakes
+//  the processor, but idle() recognises it and goes straight back to
+//  sleep, so that alone does not make loop() run.
+//
+//  Your own interrupt code can wake loop() up too, by calling
+//  BetweenerIdle::markEvent().
+//
+//  To see what it saves, BetweenerIdle keeps count of how long the
+//  processor has slept and been awake, and of the "wake latency": the
+//  time from a trigger (or markEvent) interrupt to loop() running again,
+//  in processor cycles (96 per microsecond at 96 MHz).
+//
+//  Example:
+//      void setup(){ b.begin(); BetweenerIdle::begin(); }
+//      void loop(){
+//          b.readAllInputs();
+//          ...
+//          BetweenerIdle::idle(1000);  //sleep up to 1 ms, or until something happens
+//      }
+//
+//  Note that the trigger pins can only have one interrupt each: do not
+//  ask BetweenerIdle to wake on a trigger the sequencer (or your own
+//  code) already uses with attachInterrupt.  You do not need to, anyway;
+//  that interrupt wakes the processor all by itself.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef BetweenerIdle_h
+#define BetweenerIdle_h
+
+#include <Arduino.h>
+#include "Betweener.h"
+
+
+class BetweenerIdle
+{
+    public:
+
+    //triggerMask chooses which trigger inputs wake loop(): bit 0 is
+    //trigger 1 ... so 0x0F (the default) is all four and 0 is none
+    static void begin(uint8_t triggerMask = 0x0F);
+    static void end(void);  //stops waking on triggers
+
+    //sleeps until something happens, or for at most maxMicros.  Returns
+    //true if it woke for a trigger or markEvent(), false otherwise.
+    static bool idle(uint32_t maxMicros = 1000);
+
+    //call from an interrupt to make idle() return
+    static void markEvent(void);
+
+    //the numbers for measuring the savings.  Times count from begin()
+    //or resetStats().
+    static uint64_t sleptMicros(void);   //time spent asleep
+    static uint64_t awakeMicros(void);   //time spent awake
+    static float sleepFraction(void);    //asleep / (asleep + awake), 0 to 1
+    static uint32_t wakeups(void){ return wakeups_; };           //times idle() returned
+    static uint32_t eventWakeups(void){ return eventWakeups_; }; //...because of an event
+    static uint32_t wakeLatencyCycles(void){ return latencyLast_; }; //event to loop(), last time
+    static uint32_t wakeLatencyMaxCycles(void){ return latencyMax_; }; //the worst so far
+    static void resetStats(void);
+
+
+    private:
+
+    static void triggerISR1(void);
+    static void triggerISR2(void);
+    static void triggerISR3(void);
+    static void triggerISR4(void);
+
+    static uint8_t triggerMask_;
+    static volatile bool pending_;        //an event is waiting for loop()
+    static volatile uint32_t eventCycles_; //when the waking event happened
+
+    static uint64_t slept_;
+    static void countTime(void);
+    static uint64_t total_;       //micros elapsed from begin/resetStats up to statsLast_
+    static uint32_t statsLast_;
+    static uint32_t wakeups_;
+    static uint32_t eventWakeups_;
+    static uint32_t latencyLast_;
+    static uint32_t latencyMax_;
+};
+
+
+#endif /* BetweenerIdle_h */
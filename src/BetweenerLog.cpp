@@ -0,0 +1,174 @@
+//
+//  BetweenerLog.cpp
+//
+//  Copyright (c) 2018 Kathryn Schaffer
+
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+//  BetweenerLog.cpp detailed description:
+//
+//  Implementation of BetweenerLog.  See BetweenerLog.h for how to use it.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "BetweenerLog.h"
+
+BetweenerLog::Event BetweenerLog::ring_[BETWEENER_LOG_SIZE];
+volatile uint32_t BetweenerLog::head_ = 0;
+volatile uint32_t BetweenerLog::tail_ = 0;
+uint32_t BetweenerLog::lastMillis_[BETWEENER_LOG_SITES];
+uint16_t BetweenerLog::pendingRepeats_[BETWEENER_LOG_SITES];
+bool BetweenerLog::seen_[BETWEENER_LOG_SITES];
+uint32_t BetweenerLog::rateLimitMillis_ = 100;
+volatile uint32_t BetweenerLog::dropped_ = 0;
+volatile uint32_t BetweenerLog::suppressed_ = 0;
+
+//runs flushFromYield() the next time the Teensy is idle between loop()s
+static EventResponder logIdleHook;
+static bool logIdleHookAttached = false;
+
+//the text for each library code, printed by flush()
+static const char * const logMessages[] = {
+    "unknown event",
+    "you are trying to read an nonexistent CV channel!",
+    "you are trying to read an nonexistent knob!",
+    "you are trying to read an nonexistent trigger!",
+    "you are trying to write to a nonexistent CV channel!",
+    "you are trying to use a nonexistent sequencer track!",
+    "you are trying to use a nonexistent sequencer step!",
+};
+static const int logMessageCount = sizeof(logMessages) / sizeof(logMessages[0]);
+
+
+//turns interrupts off and returns whether they were on before, so that
+//record() works the same from loop() and from inside an interrupt
+static inline uint32_t logDisableInterrupts(void){
+#if defined(__arm__)
+    uint32_t primask;
+    __asm__ volatile("mrs %0, primask\n" : "=r" (primask) :: "memory");
+    __disable_irq();
+    return primask;
+#else
+    return 0;
+#endif
+}
+
+static inline void logRestoreInterrupts(uint32_t primask){
+    if (!primask) __enable_irq();
+}
+
+
+//which rate-limit slot a code uses: library codes in the lower half,
+//user codes in the upper half
+int BetweenerLog::site(uint8_t code){
+    const int half = BETWEENER_LOG_SITES / 2;
+    if (code >= BETWEENER_LOG_USER){
+        return half + ((code - BETWEENER_LOG_USER) & (half - 1));
+    }
+    return code & (half - 1);
+}
+
+
+void BetweenerLog::record(uint8_t code, int32_t value){
+    const uint32_t now = millis();
+    const int slot = site(code);
+
+    const uint32_t primask = logDisableInterrupts();
+
+    //too soon after the last one of its kind: just count it
+    if (seen_[slot] && (now - lastMillis_[slot]) < rateLimitMillis_){
+        if (pendingRepeats_[slot] < 0xFFFF) pendingRepeats_[slot]++;
+        suppressed_++;
+        logRestoreInterrupts(primask);
+        return;
+    }
+
+    if (head_ - tail_ >= BETWEENER_LOG_SIZE){
+        dropped_++;
+        logRestoreInterrupts(primask);
+        return;
+    }
+
+    Event &e = ring_[head_ % BETWEENER_LOG_SIZE];
+    e.millis = now;
+    e.value = value;
+    e.code = code;
+    e.repeats = pendingRepeats_[slot];
+    pendingRepeats_[slot] = 0;
+    lastMillis_[slot] = now;
+    seen_[slot] = true;
+    head_ = head_ + 1;
+
+    if (!logIdleHookAttached){
+        logIdleHook.attach(flushFromYield);
+        logIdleHookAttached = true;
+    }
+    logRestoreInterrupts(primask);
+
+    //ask for a flush at the next idle moment (safe from interrupts)
+    logIdleHook.triggerEvent();
+}
+
+
+void BetweenerLog::flushFromYield(EventResponderRef event){
+    flush(Serial);
+    //if the port had no room for everything, try again next time
+    if (tail_ != head_) event.triggerEvent();
+}
+
+
+int BetweenerLog::flush(Print &out){
+    int printed = 0;
+    //a line is at most about 100 characters; do not start one that
+    //would have to wait for the port
+    while (tail_ != head_ && out.availableForWrite() >= 100){
+        //copy the event out first, so record() can reuse the slot
+        const Event e = ring_[tail_ % BETWEENER_LOG_SIZE];
+        tail_ = tail_ + 1;
+
+        out.print("[");
+        out.print(e.millis);
+        out.print(" ms] ");
+        if (e.code >= BETWEENER_LOG_USER){
+            out.print("user event ");
+            out.print(e.code - BETWEENER_LOG_USER);
+            out.print(": ");
+        }else{
+            out.print(logMessages[e.code < logMessageCount ? e.code : 0]);
+            out.print(" value: ");
+        }
+        out.print(e.value);
+        if (e.repeats){
+            out.print(" (and ");
+            out.print(e.repeats);
+            out.print(" more before this)");
+        }
+        out.println();
+        printed++;
+    }
+
+    static uint32_t reportedDropped = 0;
+    if (dropped_ != reportedDropped && out.availableForWrite() >= 100){
+        out.print("[log] ");
+        out.print(dropped_ - reportedDropped);
+        out.println(" events lost because the log was full");
+        reportedDropped = dropped_;
+    }
+    return printed;
+}
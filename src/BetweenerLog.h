@@ -0,0 +1,124 @@
+//
+//  BetweenerLog.h
+//
+//  Copyright (c) 2018 Kathryn Schaffer
+
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////
+//  BetweenerLog.h detailed description:
+//
+//  This file defines BetweenerLog, a "deferred" error log.
+//
+//  Printing an error message with Serial.println right where it happens
+//  (as DEBUG_PRINTLN does) can hold up the sketch for milliseconds if the
+//  computer is not reading the serial port, and it must never be done from
+//  an interrupt.  So the functions that run often, or inside interrupts,
+//  record errors with BETWEENER_LOG(code, value) instead.  That only
+//  stores a few bytes (what happened, the offending value, and when) in a
+//  fixed-size ring.  The text is printed later, by BetweenerLog::flush(),
+//  which never waits for the serial port either.  You do not need to call
+//  flush() yourself: the Teensy runs it automatically in between calls to
+//  loop() (and during delay()), using its EventResponder "yield" hook.
+//  Calling it yourself, e.g. at the end of loop(), is fine too.
+//
+//  To keep a mistake made thousands of times a second from flooding the
+//  log, each kind of event is recorded at most once per "rate limit"
+//  period (100 ms by default); the repeats in between are counted and
+//  reported with the next one.  If the ring fills up before it is flushed,
+//  new events are dropped and counted too.
+//
+//  Your own sketch can use the log as well, with codes from
+//  BETWEENER_LOG_USER upward:
+//      BETWEENER_LOG(BETWEENER_LOG_USER + 1, someValue);
+//  which flush() prints as "user event 1: someValue".
+//
+//  Like DEBUG_PRINTLN, BETWEENER_LOG does nothing unless DEBUG is defined
+//  in Betweener.h.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef BetweenerLog_h
+#define BetweenerLog_h
+
+#include <Arduino.h>
+#include <EventResponder.h>
+
+//what happened.  Each one has a message in BetweenerLog.cpp.
+#define BETWEENER_LOG_BAD_CV_IN 1      //nonexistent CV input channel
+#define BETWEENER_LOG_BAD_KNOB 2       //nonexistent knob
+#define BETWEENER_LOG_BAD_TRIGGER 3    //nonexistent trigger input
+#define BETWEENER_LOG_BAD_CV_OUT 4     //nonexistent CV output
+#define BETWEENER_LOG_BAD_SEQ_TRACK 5  //nonexistent sequencer track
+#define BETWEENER_LOG_BAD_SEQ_STEP 6   //nonexistent sequencer step
+#define BETWEENER_LOG_USER 128         //first code free for sketches
+
+#define BETWEENER_LOG_SIZE 32   //events the ring holds; a power of two
+//separately rate-limited codes: the library's codes and the user codes
+//(from BETWEENER_LOG_USER) each get half, so the two never share one.
+//Codes further apart than half of this within the same group do share.
+#define BETWEENER_LOG_SITES 32  //a power of two
+
+
+class BetweenerLog
+{
+    public:
+
+    //store one event.  Safe to call from anywhere, including interrupts.
+    static void record(uint8_t code, int32_t value);
+
+    //print what has been recorded as text, as far as the port has room
+    //for.  Returns the number of events printed.  Call it from loop(),
+    //never from an interrupt.
+    static int flush(Print &out = Serial);
+
+    //the shortest time between two recorded events with the same code
+    static void setRateLimit(uint32_t millisec){ rateLimitMillis_ = millisec; };
+
+    static uint32_t dropped(void){ return dropped_; };     //lost because the ring was full
+    static uint32_t suppressed(void){ return suppressed_; };  //held back by the rate limit
+
+
+    private:
+
+    static void flushFromYield(EventResponderRef event);
+    static int site(uint8_t code);
+
+    struct Event {
+        uint32_t millis;
+        int32_t value;
+        uint8_t code;
+        uint16_t repeats;  //events of this code suppressed just before this one
+    };
+
+    static Event ring_[BETWEENER_LOG_SIZE];
+    static volatile uint32_t head_;  //events ever recorded
+    static volatile uint32_t tail_;  //events ever printed
+
+    static uint32_t lastMillis_[BETWEENER_LOG_SITES];
+    static uint16_t pendingRepeats_[BETWEENER_LOG_SITES];
+    static bool seen_[BETWEENER_LOG_SITES];
+    static uint32_t rateLimitMillis_;
+
+    static volatile uint32_t dropped_;
+    static volatile uint32_t suppressed_;
+};
+
+
+#endif /* BetweenerLog_h */
@@ -0,0 +1,300 @@
+//
+//  BetweenerMIDIClock.cpp
+//
+//  Copyright (c) 2018 Kathryn Schaffer
+
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+//  BetweenerMIDIClock.cpp detailed description:
+//
+//  Implementation of BetweenerMIDIClock.  See BetweenerMIDIClock.h for how to
+//  use it.
+//
+//  All positions ("phase") are measured in MIDI ticks, stored as 64-bit
+//  numbers whose lower 32 bits are the fraction of a tick.  So 1 << 32 is one
+//  tick, and 24 << 32 is one beat.  Whole-number maths like this is exact
+//  and quick inside an interrupt, where floating point is best avoided.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "BetweenerMIDIClock.h"
+
+BetweenerMIDIClock * BetweenerMIDIClock::active_ = NULL;
+
+static const uint64_t ONE_TICK = 1ULL << 32;
+
+
+BetweenerMIDIClock::BetweenerMIDIClock(void){
+    for (int i = 0; i < 4; i++){
+        out_[i].mode = BETWEENER_CLOCK_OFF;
+        out_[i].high = false;
+        out_[i].period = BETWEENER_CLOCK_PPQN * ONE_TICK;
+        out_[i].swingDelay = 0;
+        out_[i].width = out_[i].period / 2;
+        out_[i].base = 0;
+        out_[i].odd = false;
+        out_[i].nextRise = 0;
+        out_[i].fallAt = 0;
+    }
+    phase_ = 0;
+    running_ = false;
+    waitingForFirstTick_ = false;
+    ticksReceived_ = 0;
+    lastTickMicros_ = 0;
+    tickTimesCount_ = 0;
+    tickTimesNext_ = 0;
+    //until ticks arrive, assume 120 bpm: 500000us / 24 per tick
+    tickPeriodQ8_ = (500000UL * 256) / BETWEENER_CLOCK_PPQN;
+    increment_ = (uint32_t)((ONE_TICK * BETWEENER_CLOCK_TIMER_US * 256) / tickPeriodQ8_);
+}
+
+
+bool BetweenerMIDIClock::begin(bool useUsbMIDI){
+    active_ = this;
+#if BETWEENER_USE_USB_MIDI
+    if (useUsbMIDI){
+        usbMIDI.setHandleClock(usbClock);
+        usbMIDI.setHandleStart(usbStart);
+        usbMIDI.setHandleContinue(usbContinue);
+        usbMIDI.setHandleStop(usbStop);
+    }
+#else
+    if (useUsbMIDI){
+        DEBUG_PRINTLN("BETWEENER_USE_USB_MIDI is off: call clockTick() and the others yourself");
+    }
+#endif
+    Betweener::shareDACWithTimers();
+    if (!timer_.begin(timerISR, BETWEENER_CLOCK_TIMER_US)){
+        DEBUG_PRINTLN("the MIDI clock: all the hardware timers (IntervalTimers) are in use!");
+        return false;
+    }
+    return true;
+}
+
+
+void BetweenerMIDIClock::setOutputMode(int cvout, uint8_t mode){
+    if (cvout < 1 || cvout > 4){
+        DEBUG_PRINTLN("you are trying to write to a nonexistent CV channel!");
+        return;
+    }
+    __disable_irq();
+    out_[cvout - 1].mode = mode;
+    out_[cvout - 1].high = false;
+    __enable_irq();
+    Betweener::writeCVOut(cvout, (mode == BETWEENER_CLOCK_RUN && running_) ? 4095 : 0);
+}
+
+
+void BetweenerMIDIClock::setClockOutput(int cvout, int pulsesPerBeat, int beatsPerPulse, int swingPercent){
+    if (cvout < 1 || cvout > 4) return;
+    if (pulsesPerBeat < 1) pulsesPerBeat = 1;
+    if (beatsPerPulse < 1) beatsPerPulse = 1;
+    swingPercent = constrain(swingPercent, 50, 75);
+
+    Output o = out_[cvout - 1];
+    o.period = (BETWEENER_CLOCK_PPQN * ONE_TICK * beatsPerPulse) / pulsesPerBeat;
+    //the second pulse of each pair lands at swingPercent of the pair
+    o.swingDelay = (o.period * (2 * swingPercent - 100)) / 100;
+    //narrow the pulse as swing grows, so it always ends before the next
+    //one starts: half the period when straight, a quarter at 75%
+    o.width = (o.period * (100 - swingPercent)) / 100;
+
+    __disable_irq();
+    out_[cvout - 1].period = o.period;
+    out_[cvout - 1].swingDelay = o.swingDelay;
+    out_[cvout - 1].width = o.width;
+    __enable_irq();
+    setOutputMode(cvout, BETWEENER_CLOCK_CLOCK);
+}
+
+
+void BetweenerMIDIClock::setResetOutput(int cvout){
+    setOutputMode(cvout, BETWEENER_CLOCK_RESET);
+}
+
+
+void BetweenerMIDIClock::setRunOutput(int cvout){
+    setOutputMode(cvout, BETWEENER_CLOCK_RUN);
+}
+
+
+void BetweenerMIDIClock::setOutputOff(int cvout){
+    setOutputMode(cvout, BETWEENER_CLOCK_OFF);
+}
+
+
+float BetweenerMIDIClock::bpm(void){
+    return 60000000.0 * 256.0 / ((float)tickPeriodQ8_ * BETWEENER_CLOCK_PPQN);
+}
+
+
+void BetweenerMIDIClock::restartOutputs(void){
+    //every clock output starts a fresh pair of pulses at position 0
+    for (int i = 0; i < 4; i++){
+        out_[i].base = 0;
+        out_[i].odd = false;
+        out_[i].nextRise = 0;
+    }
+}
+
+
+void BetweenerMIDIClock::start(void){
+    __disable_irq();
+    running_ = false;  //the playhead waits for the first tick
+    waitingForFirstTick_ = true;
+    ticksReceived_ = 0;
+    phase_ = 0;
+    restartOutputs();
+    __enable_irq();
+    for (int i = 0; i < 4; i++){
+        if (out_[i].mode == BETWEENER_CLOCK_RUN) Betweener::writeCVOut(i + 1, 4095);
+    }
+}
+
+
+void BetweenerMIDIClock::continuePlaying(void){
+    //pick up where we stopped; the next tick restarts the playhead
+    for (int i = 0; i < 4; i++){
+        if (out_[i].mode == BETWEENER_CLOCK_RUN) Betweener::writeCVOut(i + 1, 4095);
+    }
+    running_ = true;
+}
+
+
+void BetweenerMIDIClock::stopPlaying(void){
+    running_ = false;
+    waitingForFirstTick_ = false;
+    for (int i = 0; i < 4; i++){
+        if (out_[i].mode == BETWEENER_CLOCK_CLOCK || out_[i].mode == BETWEENER_CLOCK_RUN){
+            __disable_irq();
+            out_[i].high = false;
+            __enable_irq();
+            Betweener::writeCVOut(i + 1, 0);
+        }
+    }
+}
+
+
+void BetweenerMIDIClock::clockTick(void){
+    const uint32_t now = micros();
+
+    //the tempo: the time from the oldest of the last ticks to this one,
+    //divided by the ticks in between.  Averaging each gap instead would
+    //let a burst of late ticks, a few microseconds apart, pull the tempo
+    //far too fast after every slow usbMIDI.read().  A gap too long to be
+    //a real clock (slower than 10 bpm) starts the measuring again.
+    const uint32_t dt = now - lastTickMicros_;
+    lastTickMicros_ = now;
+    if (waitingForFirstTick_ || dt >= 250000){
+        tickTimesCount_ = 0;
+        tickTimesNext_ = 0;
+    }
+    const int slots = BETWEENER_CLOCK_TEMPO_TICKS + 1;
+    tickTimes_[tickTimesNext_] = now;
+    tickTimesNext_ = (tickTimesNext_ + 1) % slots;
+    if (tickTimesCount_ < slots) tickTimesCount_++;
+    if (tickTimesCount_ > 1){
+        const uint32_t oldest = tickTimes_[(tickTimesCount_ < slots) ? 0 : tickTimesNext_];
+        const uint32_t span = now - oldest;
+        const uint32_t period = (uint32_t)(((uint64_t)span * 256) / (tickTimesCount_ - 1));
+        if (period > 0){
+            tickPeriodQ8_ = period;
+            increment_ = (uint32_t)((ONE_TICK * BETWEENER_CLOCK_TIMER_US * 256) / tickPeriodQ8_);
+        }
+    }
+
+    if (waitingForFirstTick_){
+        //the first tick after Start is position 0: the downbeat
+        waitingForFirstTick_ = false;
+        ticksReceived_ = 0;
+        __disable_irq();
+        phase_ = 0;
+        running_ = true;
+        __enable_irq();
+        for (int i = 0; i < 4; i++){
+            if (out_[i].mode == BETWEENER_CLOCK_RESET){
+                Betweener::pulseCVOut(i + 1, 4095, BETWEENER_CLOCK_RESET_US);
+            }
+        }
+        return;
+    }
+    if (!running_) return;
+
+    ticksReceived_++;
+
+    //where the playhead should be now, and where it is.  Move it a quarter
+    //of the way toward the right place: enough to stay locked, not so much
+    //that one late tick makes a visible jump.
+    const uint64_t target = (uint64_t)ticksReceived_ << 32;
+    __disable_irq();
+    int64_t error = (int64_t)(target - phase_);
+    phase_ = phase_ + error / 4;
+    __enable_irq();
+}
+
+
+////////////////////////////////////////////////////////////////////////
+//Everything below here runs inside interrupts.
+
+void BetweenerMIDIClock::timerTick(void){
+    if (!running_) return;
+
+    //move the playhead, but not too far past the last tick received: one
+    //late usbMIDI.read() should not stall the outputs, but if the clock
+    //stops arriving, they stop too
+    uint64_t phase = phase_ + increment_;
+    const uint64_t limit = ((uint64_t)ticksReceived_ + BETWEENER_CLOCK_COAST_TICKS) << 32;
+    if (phase > limit) phase = limit;
+    phase_ = phase;
+
+    for (int i = 0; i < 4; i++){
+        Output &o = out_[i];
+        if (o.mode != BETWEENER_CLOCK_CLOCK) continue;
+
+        if (o.high && phase >= o.fallAt){
+            Betweener::writeCVOut(i + 1, 0);
+            o.high = false;
+        }
+        if (phase >= o.nextRise){
+            Betweener::writeCVOut(i + 1, 4095);
+            o.high = true;
+            o.fallAt = o.nextRise + o.width;
+            //line up the next pulse: the second of a pair is delayed by
+            //the swing, and then the pair moves on by two periods
+            if (!o.odd){
+                o.nextRise = o.base + o.period + o.swingDelay;
+                o.odd = true;
+            }else{
+                o.base = o.base + 2 * o.period;
+                o.nextRise = o.base;
+                o.odd = false;
+            }
+        }
+    }
+}
+
+
+void BetweenerMIDIClock::timerISR(void){
+    if (active_) active_->timerTick();
+}
+
+void BetweenerMIDIClock::usbClock(void){ if (active_) active_->clockTick(); }
+void BetweenerMIDIClock::usbStart(void){ if (active_) active_->start(); }
+void BetweenerMIDIClock::usbContinue(void){ if (active_) active_->continuePlaying(); }
+void BetweenerMIDIClock::usbStop(void){ if (active_) active_->stopPlaying(); }
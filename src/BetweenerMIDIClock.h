@@ -0,0 +1,179 @@
+//
+//  BetweenerMIDIClock.h
+//
+//  Copyright (c) 2018 Kathryn Schaffer
+
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////
+//  BetweenerMIDIClock.h detailed description:
+//
+//  This file defines BetweenerMIDIClock, which turns MIDI clock from a DAW
+//  (or anything else) into clean clock, reset and run signals on the CV
+//  outputs, for a modular that should follow the computer's tempo.
+//
+//  MIDI clock sends 24 "tick" messages per quarter note.  They arrive
+//  whenever the sketch happens to call usbMIDI.read(), so on their own they
+//  are jittery.  This object instead:
+//      - notes the time of every tick and measures the tempo over the last
+//        BETWEENER_CLOCK_TEMPO_TICKS of them (one beat),
+//      - runs its own "playhead" from a hardware timer every 50 microseconds,
+//        moving at the averaged tempo, and gently nudges it back into line
+//        whenever a tick arrives,
+//      - makes the clock edges from that timer.
+//  So the outputs stay steady even if the ticks are read late, and clock
+//  multiplication works: edges between ticks are extrapolated.
+//
+//  One limit to know about: the time noted for a tick is when
+//  usbMIDI.read() hands it to this object, not when it reached the Teensy
+//  (the USB code does not say).  So the tempo and the phase still follow
+//  how often your loop() reads MIDI; the measuring and the gentle nudges
+//  only smooth that out.  A late read hands over several ticks at almost
+//  the same moment, but as the tempo is the time across a whole beat
+//  divided by its ticks, that moves it by only the delay / 24, and it
+//  comes back once the late ticks leave the beat.  Read MIDI as often as you can: every time round
+//  loop(), or with BetweenerScheduler's addReadUsbMIDI.  If a read comes
+//  late, the playhead carries on at the last tempo for up to
+//  BETWEENER_CLOCK_COAST_TICKS ticks past the last one received, so the
+//  outputs do not stall, and only stop if the clock really has stopped.
+//
+//  Each CV out can be set to one of:
+//      - a clock at any ratio of the beat, e.g. 4 per beat (16ths), 1 per
+//        beat, or 1 per 4 beats (bars), with optional swing
+//      - a reset pulse, sent on the first tick after MIDI Start
+//      - a run gate, high between Start/Continue and Stop
+//
+//  Example:
+//      Betweener b;
+//      BetweenerMIDIClock clock;
+//      void setup(){
+//          b.begin();
+//          clock.setClockOutput(1, 4, 1);   //out 1: 16th notes
+//          clock.setClockOutput(2, 1, 1);   //out 2: quarter notes
+//          clock.setResetOutput(3);
+//          clock.setRunOutput(4);
+//          clock.begin();                   //also hooks up usbMIDI
+//      }
+//      void loop(){ usbMIDI.read(); }
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef BetweenerMIDIClock_h
+#define BetweenerMIDIClock_h
+
+#include <Arduino.h>
+#include "Betweener.h"
+
+#define BETWEENER_CLOCK_PPQN 24      //MIDI clock ticks per quarter note
+#define BETWEENER_CLOCK_TIMER_US 50  //how often the playhead moves
+#define BETWEENER_CLOCK_RESET_US 5000  //length of the reset pulse
+#define BETWEENER_CLOCK_COAST_TICKS 6  //how far the playhead may run past the last tick
+#define BETWEENER_CLOCK_TEMPO_TICKS 24  //the tempo is measured over this many ticks
+
+//what each output does
+#define BETWEENER_CLOCK_OFF 0
+#define BETWEENER_CLOCK_CLOCK 1
+#define BETWEENER_CLOCK_RESET 2
+#define BETWEENER_CLOCK_RUN 3
+
+
+class BetweenerMIDIClock
+{
+    public:
+
+    BetweenerMIDIClock(void);
+
+    //start the timer, and (if useUsbMIDI) register the clock handlers with
+    //usbMIDI.  Your loop() still needs to call usbMIDI.read() (or
+    //b.readUsbMIDI()) so the messages are received.  With
+    //BETWEENER_USE_USB_MIDI off (BetweenerConfig.h) there is no usbMIDI,
+    //so feed the clock with clockTick() and the others below instead.
+    //Returns false if no hardware timer was free.
+    bool begin(bool useUsbMIDI = true);
+
+    //Output setup, outputs 1-4.  For clocks, the rate is
+    //pulsesPerBeat / beatsPerPulse, e.g. (4, 1) is sixteenth notes,
+    //(3, 1) is eighth-note triplets, (1, 4) is one pulse per bar of 4/4.
+    //Swing is 50 (straight) to 75 percent; every second pulse is
+    //delayed to land at that percentage of the pair.
+    void setClockOutput(int cvout, int pulsesPerBeat, int beatsPerPulse = 1, int swingPercent = 50);
+    void setResetOutput(int cvout);
+    void setRunOutput(int cvout);
+    void setOutputOff(int cvout);
+
+    //Call these if the MIDI comes from somewhere other than usbMIDI (e.g.
+    //DIN MIDI).  begin(true) wires them up to usbMIDI for you.
+    void clockTick(void);
+    void start(void);
+    void continuePlaying(void);
+    void stopPlaying(void);
+
+    float bpm(void);          //the current tempo estimate
+    bool running(void){ return running_; };
+    uint32_t ticks(void){ return ticksReceived_; };  //ticks since Start
+
+
+    private:
+
+    struct Output {
+        uint8_t mode;
+        bool high;
+        uint64_t period;      //between pulses, in ticks << 32
+        uint64_t swingDelay;  //extra delay of every second pulse
+        uint64_t width;       //how long each pulse stays high
+        uint64_t base;        //where the current pair of pulses starts
+        bool odd;             //the next pulse is the second of its pair
+        uint64_t nextRise;
+        uint64_t fallAt;
+    };
+
+    void restartOutputs(void);
+    void setOutputMode(int cvout, uint8_t mode);
+    void timerTick(void);
+
+    static void timerISR(void);
+    static void usbClock(void);
+    static void usbStart(void);
+    static void usbContinue(void);
+    static void usbStop(void);
+
+    static BetweenerMIDIClock *active_;
+
+    IntervalTimer timer_;
+    Output out_[4];
+
+    //the playhead, in MIDI ticks with 32 bits of fraction
+    volatile uint64_t phase_;
+    volatile uint32_t increment_;  //added every timer period
+    volatile bool running_;
+    volatile bool waitingForFirstTick_;
+    volatile uint32_t ticksReceived_;
+
+    uint32_t lastTickMicros_;
+    uint32_t tickPeriodQ8_;  //measured microseconds per tick, times 256
+
+    //the times of the last ticks, oldest first from tickTimesNext_ once
+    //the list is full, for measuring the tempo
+    uint32_t tickTimes_[BETWEENER_CLOCK_TEMPO_TICKS + 1];
+    uint8_t tickTimesCount_;
+    uint8_t tickTimesNext_;
+};
+
+
+#endif /* BetweenerMIDIClock_h */
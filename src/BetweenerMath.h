@@ -0,0 +1,104 @@
+//
+//  BetweenerMath.h
+//
+//  Copyright (c) 2018 Kathryn Schaffer
+
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////
+//  BetweenerMath.h detailed description:
+//
+//  This file holds the library's small pure calculations: the scaling
+//  between readings, MIDI values and DAC codes, the sequencer's note and
+//  step packing, and the Fletcher-16 checksum used by the telemetry and
+//  CV stream packets.  The classes call these, rather than each keeping
+//  its own copy.
+//
+//  Nothing here touches the Teensy's hardware, so this file also compiles
+//  on a computer.  extras/bench/host_bench.cpp times these very functions,
+//  so a change made here shows up in its before/after numbers.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef BetweenerMath_h
+#define BetweenerMath_h
+
+#include <stdint.h>
+
+#define BETWEENER_SEQ_MAX_NOTE 60  //5 octaves over the 0-5V range
+
+
+namespace BetweenerMath {
+
+    //a reading of 'bits' bits (10 by default) to a 7-bit MIDI value,
+    //by simply shifting off the extra bits
+    inline int CVtoMIDI(int val, int bits){
+        return val >> (bits - 7);
+    }
+
+    //a 7-bit MIDI value (0-127) to a 12-bit DAC code (0-4095).  This is
+    //the sum Arduino's map(val, 0, 127, 0, 4095) does.
+    inline int MIDItoCV(int val){
+        return val * 4095 / 127;
+    }
+
+    //a reading of 'bits' bits to a 12-bit DAC code, likewise
+    //map(val, 0, 2^bits - 1, 0, 4095).  (The Teensy's map() shrinks a
+    //wider range, here over 12 bits, with a slightly different sum, which
+    //comes down to dropping the extra bits.)
+    inline int knobToCV(int val, int bits){
+        if (bits > 12) return val >> (bits - 12);
+        return val * 4095 / ((1 << bits) - 1);
+    }
+
+    //the DAC code for a note, 1V/octave: the DACs put out 0-5V over
+    //0-4095, so one volt (one octave) is 819 steps and a semitone is
+    //68.25.  Rounded to the nearest step.
+    inline uint16_t noteToCV(int note){
+        if (note < 0) note = 0;
+        if (note > BETWEENER_SEQ_MAX_NOTE) note = BETWEENER_SEQ_MAX_NOTE;
+        return (uint16_t)((note * 4095 + BETWEENER_SEQ_MAX_NOTE / 2) / BETWEENER_SEQ_MAX_NOTE);
+    }
+
+    //one sequencer step, packed so it can be stored in a single write:
+    //  bits  0-11  pitch DAC code
+    //  bits 12-23  CV DAC code
+    //  bit  24     gate
+    //  bits 25-31  note number (kept so it can be read back)
+    inline uint32_t packStep(int note, bool gate, int cv){
+        return (uint32_t)noteToCV(note) | ((uint32_t)(cv & 0xFFF) << 12)
+             | ((gate ? 1UL : 0UL) << 24) | ((uint32_t)note << 25);
+    }
+
+    //Fletcher-16 of the bytes from 'from' up to (not including) 'to'.
+    //The first sum is in the low byte, the second in the high byte, the
+    //order they go into a packet.
+    inline uint16_t fletcher16(const uint8_t *from, const uint8_t *to){
+        uint16_t sum1 = 0;
+        uint16_t sum2 = 0;
+        for (const uint8_t *q = from; q < to; q++){
+            sum1 = (sum1 + *q) % 255;
+            sum2 = (sum2 + sum1) % 255;
+        }
+        return sum1 | (sum2 << 8);
+    }
+}
+
+
+#endif /* BetweenerMath_h */
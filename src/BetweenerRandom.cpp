@@ -0,0 +1,244 @@
+//
+//  BetweenerRandom.cpp
+//
+//  Copyright (c) 2018 Kathryn Schaffer
+
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+//  BetweenerRandom.cpp detailed description:
+//
+//  Implementation of BetweenerRandom.  See BetweenerRandom.h for how to use
+//  it; the maths for each output is BetweenerRandomVoice, in the header.
+//  The set... functions work out the fixed-point numbers once, with
+//  floats, so that tick() (in the timer interrupt) only adds, multiplies
+//  and shifts whole numbers.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "BetweenerRandom.h"
+
+//the hardware half only; the rest of the header also builds on a computer
+#if defined(ARDUINO)
+
+BetweenerRandom * BetweenerRandom::active_ = NULL;
+
+
+BetweenerRandom::BetweenerRandom(uint32_t seed){
+    for (int i = 0; i < 4; i++){
+        smoothRate_[i] = 1.0;
+        brownianRate_[i] = 1000.0;
+        trigger_[i] = 0;
+        clocks_[i] = 0;
+        clocksSeen_[i] = 0;
+        values_[i] = 0xFFFF;  //nothing written yet
+    }
+    this->seed(seed);
+}
+
+
+bool BetweenerRandom::begin(float ticksPerSecond){
+    if (ticksPerSecond <= 0){
+        DEBUG_PRINTLN("random outputs need a positive control rate!");
+        return false;
+    }
+    active_ = this;
+    rate_ = ticksPerSecond;
+    //the rates are per second, so the steps depend on the tick rate
+    for (int i = 0; i < 4; i++){
+        const uint8_t mode = voices_[i].mode();
+        if (mode == BETWEENER_RANDOM_SMOOTH) setSmooth(i + 1, smoothRate_[i]);
+        if (mode == BETWEENER_RANDOM_BROWNIAN) setBrownian(i + 1, brownianRate_[i]);
+    }
+    Betweener::shareDACWithTimers();
+    if (!timer_.begin(timerISR, (float)(1000000.0 / ticksPerSecond))){
+        DEBUG_PRINTLN("random outputs: all the hardware timers (IntervalTimers) are in use!");
+        return false;
+    }
+    return true;
+}
+
+
+void BetweenerRandom::end(void){
+    timer_.end();
+}
+
+
+void BetweenerRandom::seed(uint32_t seed){
+    for (int i = 1; i <= 4; i++){
+        this->seed(i, seed);
+    }
+}
+
+
+void BetweenerRandom::seed(int cvout, uint32_t seed){
+    if (!validOutput(cvout)) return;
+    __disable_irq();
+    voices_[cvout - 1].seed(seed, cvout);
+    __enable_irq();
+}
+
+
+bool BetweenerRandom::validOutput(int cvout){
+    if (cvout < 1 || cvout > 4){
+        DEBUG_PRINTLN("you are trying to use a nonexistent CV out!");
+        return false;
+    }
+    return true;
+}
+
+
+void BetweenerRandom::setMode(int cvout, uint8_t mode){
+    __disable_irq();
+    voices_[cvout - 1].setMode(mode);
+    __enable_irq();
+}
+
+
+void BetweenerRandom::setWhite(int cvout){
+    if (!validOutput(cvout)) return;
+    setMode(cvout, BETWEENER_RANDOM_WHITE);
+}
+
+
+void BetweenerRandom::setSmooth(int cvout, float changesPerSecond){
+    if (!validOutput(cvout)) return;
+    if (changesPerSecond <= 0){
+        DEBUG_PRINTLN("smooth random needs a positive rate!");
+        return;
+    }
+    smoothRate_[cvout - 1] = changesPerSecond;
+    const float ticks = rate_ / changesPerSecond;
+    __disable_irq();
+    //only restart the glide when switching to smooth, so that turning a
+    //rate knob does not make the output jump
+    if (voices_[cvout - 1].mode() != BETWEENER_RANDOM_SMOOTH){
+        voices_[cvout - 1].setMode(BETWEENER_RANDOM_SMOOTH);
+    }
+    voices_[cvout - 1].setSegmentTicks(ticks >= 1 ? (uint32_t)(ticks + 0.5) : 1);
+    __enable_irq();
+}
+
+
+void BetweenerRandom::setBrownian(int cvout, float codesPerSecond){
+    if (!validOutput(cvout)) return;
+    if (codesPerSecond < 0) codesPerSecond = 0;
+    brownianRate_[cvout - 1] = codesPerSecond;
+    float step = codesPerSecond / rate_;
+    if (step > 4095) step = 4095;
+    __disable_irq();
+    if (voices_[cvout - 1].mode() != BETWEENER_RANDOM_BROWNIAN){
+        voices_[cvout - 1].setMode(BETWEENER_RANDOM_BROWNIAN);
+    }
+    voices_[cvout - 1].setMaxStep((int32_t)(step * 65536.0));
+    __enable_irq();
+}
+
+
+void BetweenerRandom::setStepped(int cvout, int trigger){
+    if (!validOutput(cvout)) return;
+    if (trigger < 1 || trigger > 4){
+        DEBUG_PRINTLN("you are trying to use a nonexistent trigger!");
+        return;
+    }
+    attachTrigger(trigger);
+    __disable_irq();
+    trigger_[cvout - 1] = trigger;
+    voices_[cvout - 1].setMode(BETWEENER_RANDOM_STEPPED);
+    __enable_irq();
+}
+
+
+void BetweenerRandom::setOff(int cvout){
+    if (!validOutput(cvout)) return;
+    setMode(cvout, BETWEENER_RANDOM_OFF);
+}
+
+
+void BetweenerRandom::setRange(int cvout, int low, int high){
+    if (!validOutput(cvout)) return;
+    low = constrain(low, 0, 4095);
+    high = constrain(high, 0, 4095);
+    __disable_irq();
+    voices_[cvout - 1].setRange(low, high);
+    __enable_irq();
+}
+
+
+int BetweenerRandom::value(int cvout){
+    if (!validOutput(cvout)) return -1;
+    const uint16_t v = values_[cvout - 1];
+    return v == 0xFFFF ? -1 : v;
+}
+
+
+void BetweenerRandom::attachTrigger(int trigger){
+    active_ = this;
+    if (attached_ & (1 << (trigger - 1))) return;
+    attached_ |= 1 << (trigger - 1);
+
+    //the interrupt only counts the edge; the timer picks the new value at
+    //its next tick, so stepped outputs change at the control rate too.
+    //The trigger inputs are inverted by the hardware, so a trigger going
+    //high is the pin falling.
+    void (*isr)(void) = triggerISR1;
+    if (trigger == 2) isr = triggerISR2;
+    if (trigger == 3) isr = triggerISR3;
+    if (trigger == 4) isr = triggerISR4;
+    attachInterrupt(BETWEENER_BOARD.triggerPins[trigger - 1], isr, FALLING);
+}
+
+
+////////////////////////////////////////////////////////////////////////
+//Everything below here runs inside interrupts.
+
+void BetweenerRandom::tick(void){
+    //which triggers went high since the last tick
+    bool clocked[4];
+    for (int t = 0; t < 4; t++){
+        const uint8_t seen = clocks_[t];
+        clocked[t] = (seen != clocksSeen_[t]);
+        clocksSeen_[t] = seen;
+    }
+
+    for (int i = 0; i < 4; i++){
+        const uint8_t mode = voices_[i].mode();
+        if (mode == BETWEENER_RANDOM_OFF) continue;
+        const bool clock = trigger_[i] && clocked[trigger_[i] - 1];
+        const uint16_t code = voices_[i].tick(clock);
+        //only touch the DAC when the value changes (stepped and slow
+        //smooth outputs mostly hold)
+        if (code != values_[i]){
+            Betweener::writeCVOut(i + 1, code);
+            values_[i] = code;
+        }
+    }
+}
+
+
+void BetweenerRandom::timerISR(void){
+    if (active_) active_->tick();
+}
+
+
+void BetweenerRandom::triggerISR1(void){ if (active_) active_->clocks_[0]++; }
+void BetweenerRandom::triggerISR2(void){ if (active_) active_->clocks_[1]++; }
+void BetweenerRandom::triggerISR3(void){ if (active_) active_->clocks_[2]++; }
+void BetweenerRandom::triggerISR4(void){ if (active_) active_->clocks_[3]++; }
+
+#endif /* ARDUINO */
@@ -0,0 +1,343 @@
+//
+//  BetweenerRandom.h
+//
+//  Copyright (c) 2018 Kathryn Schaffer
+
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////
+//  BetweenerRandom.h detailed description:
+//
+//  This file defines BetweenerRandom, which turns the CV outs into random
+//  voltage sources, the staple "random", "smooth random" and clocked
+//  "sample and hold noise" of a modular.
+//
+//  Each CV out can be set to one of:
+//      - white: a new random voltage on every control tick (1000 times a
+//        second by default), i.e. noise
+//      - smooth: a new random voltage a few times a second, with the
+//        output gliding in a straight line from one to the next
+//      - Brownian: a "random walk", moving a random small step up or down
+//        on every tick, bouncing off the ends of its range
+//      - stepped: a new random voltage each time a trigger input goes
+//        high, held until the next one (random sample and hold)
+//  and each has its own range, e.g. 0-4095 for the whole 0-5V, or
+//  1638-2457 for a gentle wobble around 2.5V.
+//
+//  A hardware timer does all of the work at a fixed "control rate", in
+//  whole-number ("fixed point") maths: no floats and no random() inside
+//  the interrupt, and loop() is left free for your sketch.
+//
+//  The random numbers come from a small "pseudo-random" generator: a
+//  formula that gives a sequence that looks random but is completely
+//  decided by the number it starts from, the "seed".  The same seed
+//  always gives the same voltages, so a patch can be repeated exactly.
+//  Each output has its own sequence (output 1 is "stream" 1, and so on),
+//  so changing what one output does does not change the others.  For a
+//  different patch every time, seed it from something unpredictable, e.g.
+//      rnd.seed(analogRead(A10) * micros());
+//  The generator is PCG32, or xorshift32 if BETWEENER_RANDOM_XORSHIFT is
+//  set to 1 in BetweenerConfig.h.  Both are usable on their own too:
+//      BetweenerPCG32 g;  g.seed(42, 0);  uint32_t r = g.next();
+//
+//  The generators and BetweenerRandomVoice (one output's worth of the
+//  maths, without the timer or the DACs) do not need a Teensy: this part
+//  of the file also compiles on a computer, as extras/bench/host_bench.cpp
+//  does, so a sequence can be worked out or checked there.
+//  extras/random/host_random_check.cpp checks the generators against
+//  their reference sequences and the voices against fixed runs; run it
+//  after changing anything here.
+//
+//  Example:
+//      Betweener b;
+//      BetweenerRandom rnd;
+//      void setup(){
+//          b.begin();
+//          rnd.setSmooth(1, 2.0);         //out 1: two new voltages a second
+//          rnd.setStepped(2, 1);          //out 2: a new voltage per trigger 1
+//          rnd.setRange(2, 0, 819);       //     between 0 and 1V
+//          rnd.begin();                   //1000 ticks a second
+//      }
+//      void loop(){ ... }  //nothing needed here
+//
+//  Like the sample and hold, each trigger pin can only have one
+//  interrupt, so do not also attach the sequencer or BetweenerSampleHold
+//  to a trigger used for stepped mode.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef BetweenerRandom_h
+#define BetweenerRandom_h
+
+#include <stdint.h>
+#include "BetweenerConfig.h"
+
+//what each output does
+#define BETWEENER_RANDOM_OFF 0
+#define BETWEENER_RANDOM_WHITE 1
+#define BETWEENER_RANDOM_SMOOTH 2
+#define BETWEENER_RANDOM_BROWNIAN 3
+#define BETWEENER_RANDOM_STEPPED 4
+
+#define BETWEENER_RANDOM_RATE 1000  //default control ticks per second
+
+
+//PCG32 (pcg-random.org): 64 bits of state, 32 bits out.  The stream
+//picks one of 2^63 different sequences for the same seed.
+class BetweenerPCG32
+{
+    public:
+
+    void seed(uint32_t seed, uint32_t stream){
+        state_ = 0;
+        inc_ = ((uint64_t)stream << 1) | 1;
+        next();
+        state_ += seed;
+        next();
+    };
+
+    uint32_t next(void){
+        const uint64_t old = state_;
+        state_ = old * 6364136223846793005ULL + inc_;
+        const uint32_t shuffled = (uint32_t)(((old >> 18) ^ old) >> 27);
+        const uint32_t rotate = (uint32_t)(old >> 59);
+        return (shuffled >> rotate) | (shuffled << ((32 - rotate) & 31));
+    };
+
+    private:
+
+    uint64_t state_ = 0x853C49E6748FEA9BULL;
+    uint64_t inc_ = 0xDA3E39CB94B95BDBULL;
+};
+
+
+//Marsaglia's xorshift32: 32 bits of state, three shifts per number.  The
+//seed and stream are mixed together into the starting state.
+class BetweenerXorshift32
+{
+    public:
+
+    void seed(uint32_t seed, uint32_t stream){
+        //the "finalizer" of MurmurHash3 spreads every bit of the input
+        //over the whole state, so seeds 1 and 2 start far apart
+        uint32_t x = seed + stream * 0x9E3779B9UL;
+        x ^= x >> 16;
+        x *= 0x85EBCA6BUL;
+        x ^= x >> 13;
+        x *= 0xC2B2AE35UL;
+        x ^= x >> 16;
+        state_ = x ? x : 0x6D2B79F5UL;  //0 would stay 0 for ever
+    };
+
+    uint32_t next(void){
+        uint32_t x = state_;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        state_ = x;
+        return x;
+    };
+
+    private:
+
+    uint32_t state_ = 2463534242UL;
+};
+
+
+#if BETWEENER_RANDOM_XORSHIFT
+typedef BetweenerXorshift32 BetweenerRandomGenerator;
+#else
+typedef BetweenerPCG32 BetweenerRandomGenerator;
+#endif
+
+
+//One output's random source.  Values are DAC codes kept as 16.16 fixed
+//point (the code times 65536), so that slow glides and small Brownian
+//steps do not get lost to rounding.
+class BetweenerRandomVoice
+{
+    public:
+
+    void seed(uint32_t seed, uint32_t stream){ rng_.seed(seed, stream); };
+
+    void setMode(uint8_t mode){ mode_ = mode; ticksLeft_ = 0; };
+    uint8_t mode(void){ return mode_; };
+
+    //the lowest and highest code the output may take, 0-4095
+    void setRange(uint16_t low, uint16_t high){
+        if (low > high){ const uint16_t t = low; low = high; high = t; }
+        low_ = low;
+        high_ = high > 4095 ? 4095 : high;
+        if (low_ > high_) low_ = high_;
+        value_ = clampQ16(value_);
+        ticksLeft_ = 0;
+    };
+
+    //smooth mode: ticks from one random voltage to the next, at least 1
+    void setSegmentTicks(uint32_t ticks){ segmentTicks_ = ticks ? ticks : 1; };
+
+    //Brownian mode: the largest step per tick, in 16.16 codes
+    void setMaxStep(int32_t stepQ16){ maxStep_ = stepQ16 > 0 ? stepQ16 : 0; };
+
+    //a random code from low to high, with every code equally likely (to
+    //within 1 part in 2^32), by one 32 x 32 bit multiply
+    uint16_t uniform(void){
+        const uint32_t span = (uint32_t)(high_ - low_) + 1;
+        return low_ + (uint16_t)(((uint64_t)rng_.next() * span) >> 32);
+    };
+
+    //one control tick.  clocked is whether the trigger for stepped mode
+    //went high since the last tick.  Returns the DAC code to write.
+    uint16_t tick(bool clocked){
+        switch (mode_){
+            case BETWEENER_RANDOM_WHITE:
+                value_ = (int32_t)uniform() << 16;
+                break;
+
+            case BETWEENER_RANDOM_SMOOTH:
+                if (ticksLeft_ == 0){
+                    //pick the next target and the slope that gets there
+                    target_ = (int32_t)uniform() << 16;
+                    ticksLeft_ = segmentTicks_;
+                    slope_ = (target_ - value_) / (int32_t)segmentTicks_;
+                }
+                ticksLeft_--;
+                //land exactly on the target, whatever the rounding of the slope
+                value_ = ticksLeft_ ? value_ + slope_ : target_;
+                break;
+
+            case BETWEENER_RANDOM_BROWNIAN: {
+                //a step from -maxStep to +maxStep: the random number as a
+                //signed fraction of one, times maxStep
+                const int32_t step = (int32_t)(((int64_t)(int32_t)rng_.next() * maxStep_) >> 31);
+                const int32_t lo = (int32_t)low_ << 16;
+                const int32_t hi = (int32_t)high_ << 16;
+                int32_t v = value_ + step;
+                if (v > hi) v = 2 * hi - v;   //bounce off the ends
+                if (v < lo) v = 2 * lo - v;
+                value_ = clampQ16(v);
+                break;
+            }
+
+            case BETWEENER_RANDOM_STEPPED:
+                if (clocked) value_ = (int32_t)uniform() << 16;
+                break;
+
+            default:
+                break;
+        }
+        return code();
+    };
+
+    //the current value as a DAC code, rounded to the nearest
+    uint16_t code(void){
+        const int32_t c = (value_ + 0x8000) >> 16;
+        return c > high_ ? high_ : (uint16_t)c;
+    };
+
+
+    private:
+
+    int32_t clampQ16(int32_t v){
+        const int32_t lo = (int32_t)low_ << 16;
+        const int32_t hi = (int32_t)high_ << 16;
+        return v < lo ? lo : (v > hi ? hi : v);
+    };
+
+    BetweenerRandomGenerator rng_;
+    uint8_t mode_ = BETWEENER_RANDOM_OFF;
+    uint16_t low_ = 0;
+    uint16_t high_ = 4095;
+    int32_t value_ = 0;
+    int32_t target_ = 0;
+    int32_t slope_ = 0;
+    uint32_t ticksLeft_ = 0;
+    uint32_t segmentTicks_ = 500;
+    int32_t maxStep_ = 1 << 16;
+};
+
+
+#if defined(ARDUINO)
+
+#include <Arduino.h>
+#include "Betweener.h"
+
+
+class BetweenerRandom
+{
+    public:
+
+    //all four outputs start off, over the whole 0-4095 range, seeded with
+    //'seed' (so two sketches with the same seed make the same voltages)
+    BetweenerRandom(uint32_t seed = 1);
+
+    //start the control timer.  Set the outputs up before or after; the
+    //rates given to setSmooth and setBrownian are per second either way.
+    //Returns false if no hardware timer was free.
+    bool begin(float ticksPerSecond = BETWEENER_RANDOM_RATE);
+    void end(void);
+
+    //start every output's sequence again from this seed
+    void seed(uint32_t seed);
+    void seed(int cvout, uint32_t seed);
+
+    //modes, outputs 1-4
+    void setWhite(int cvout);
+    void setSmooth(int cvout, float changesPerSecond);
+    void setBrownian(int cvout, float codesPerSecond);  //the largest speed of the walk
+    void setStepped(int cvout, int trigger);            //triggers 1-4
+    void setOff(int cvout);                             //the output is left as it is
+
+    void setRange(int cvout, int low, int high);  //DAC codes, 0-4095
+
+    int value(int cvout);  //the code last written, or -1 if none yet
+
+    //one control tick: the timer calls this.  Public so a sketch (or a
+    //test) can step the outputs itself instead of calling begin().
+    void tick(void);
+
+
+    private:
+
+    bool validOutput(int cvout);
+    void setMode(int cvout, uint8_t mode);
+    void attachTrigger(int trigger);
+    static void timerISR(void);
+    static void triggerISR1(void);
+    static void triggerISR2(void);
+    static void triggerISR3(void);
+    static void triggerISR4(void);
+    static BetweenerRandom *active_;
+
+    IntervalTimer timer_;
+    float rate_ = BETWEENER_RANDOM_RATE;
+    BetweenerRandomVoice voices_[4];
+    float smoothRate_[4];     //what setSmooth/setBrownian asked for, so
+    float brownianRate_[4];   //begin() can work the ticks out again
+    uint8_t trigger_[4];      //for stepped mode, 1-4; 0 = none
+    uint8_t attached_ = 0;    //triggers with our interrupt, bit 0 = trigger 1
+    volatile uint8_t clocks_[4];  //rising edges seen by each trigger interrupt
+    uint8_t clocksSeen_[4];       //... and by the timer
+    volatile uint16_t values_[4];
+};
+
+#endif /* ARDUINO */
+
+
+#endif /* BetweenerRandom_h */
@@ -0,0 +1,434 @@
+//
+//  BetweenerRecorder.cpp
+//
+//  Copyright (c) 2018 Kathryn Schaffer
+
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+//  BetweenerRecorder.cpp detailed description:
+//
+//  Implementation of BetweenerRecorder.  See BetweenerRecorder.h for the
+//  block format and how to use it.  captureFrame() and playFrame() run
+//  inside the timer interrupt; update() and the functions it calls run
+//  from loop() and are the only ones that touch the storage.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "BetweenerRecorder.h"
+
+BetweenerRecorder * BetweenerRecorder::active_ = NULL;
+
+#define HEADER_SIZE 22
+#define KEYFRAME_END (HEADER_SIZE + 1 + 16)
+#define MAX_FRAME_SIZE (2 + 8 * 3)  //trigger byte, mask, 8 changes of up to 3 bytes
+
+
+//little helpers to lay numbers into a block byte by byte, lowest byte first
+static inline void put16(uint8_t *p, uint16_t v){
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static inline void put32(uint8_t *p, uint32_t v){
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+static inline uint16_t get16(const uint8_t *p){
+    return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t get32(const uint8_t *p){
+    return p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+//a change, zigzag encoded and written 7 bits at a time.  Returns the bytes used.
+static inline int putChange(uint8_t *p, int32_t change){
+    uint32_t z = ((uint32_t)change << 1) ^ (uint32_t)(change >> 31);
+    int n = 0;
+    while (z >= 0x80){
+        p[n++] = (z & 0x7F) | 0x80;
+        z >>= 7;
+    }
+    p[n++] = z;
+    return n;
+}
+
+//reads one change back, moving pos past it, but never past 'end'
+static inline int32_t getChange(const uint8_t *block, uint16_t &pos, uint16_t end){
+    uint32_t z = 0;
+    int shift = 0;
+    while (pos < end && shift < 28){
+        const uint8_t byte = block[pos++];
+        z |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) break;
+        shift += 7;
+    }
+    return (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+}
+
+
+BetweenerRecorder::BetweenerRecorder(Betweener &b) : b_(b){
+    for (int i = 0; i < 8; i++) values_[i] = 0;
+    for (int i = 0; i < 4; i++) lastOut_[i] = -1;
+}
+
+
+void BetweenerRecorder::setOutput(int cvout, int source){
+    if (cvout < 1 || cvout > 4){
+        DEBUG_PRINTLN("you are trying to play back to a nonexistent CV channel!");
+        return;
+    }
+    if (source < BETWEENER_RECORD_NONE || source > BETWEENER_RECORD_TRIGGER1 + 3){
+        DEBUG_PRINTLN("there is no such recorded input to play back");
+        return;
+    }
+    sources_[cvout - 1] = source;
+    lastOut_[cvout - 1] = -1;
+}
+
+
+bool BetweenerRecorder::record(BetweenerRecordStorage &storage, float framesPerSecond){
+    stop();
+    if (framesPerSecond <= 0){
+        DEBUG_PRINTLN("the recorder needs a positive frame rate!");
+        return false;
+    }
+    storage_ = &storage;
+    blocksIn_ = 0;
+    blocksOut_ = 0;
+    blockOpen_ = false;
+    blockNumber_ = 0;
+    endOfData_ = false;
+    frames_ = 0;
+    framesDropped_ = 0;
+    underruns_ = 0;
+    blocksDone_ = 0;
+    storageErrors_ = 0;
+    minFreeBlocks_ = BETWEENER_RECORD_BLOCKS;
+    maxStorageMicros_ = 0;
+    encodedBytes_ = 0;
+    encodedFrames_ = 0;
+    cvBits_ = b_.CVBits();
+    knobBits_ = b_.knobBits();
+    periodMicros_ = (uint32_t)(1000000.0 / framesPerSecond + 0.5);
+
+    active_ = this;
+    startMicros_ = micros();
+    mode_ = MODE_RECORD;
+    if (!timer_.begin(timerISR, (float)(1000000.0 / framesPerSecond))){
+        DEBUG_PRINTLN("the recorder: all the hardware timers (IntervalTimers) are in use!");
+        mode_ = MODE_IDLE;
+        return false;
+    }
+    return true;
+}
+
+
+bool BetweenerRecorder::play(BetweenerRecordStorage &storage){
+    stop();
+    storage_ = &storage;
+    blocksIn_ = 0;
+    blocksOut_ = 0;
+    blockOpen_ = false;
+    endOfData_ = false;
+    frames_ = 0;
+    framesDropped_ = 0;
+    underruns_ = 0;
+    blocksDone_ = 0;
+    storageErrors_ = 0;
+    minFreeBlocks_ = BETWEENER_RECORD_BLOCKS;
+    maxStorageMicros_ = 0;
+    encodedBytes_ = 0;
+    encodedFrames_ = 0;
+    for (int i = 0; i < 4; i++) lastOut_[i] = -1;
+
+    //read ahead as far as RAM allows before starting, and take the frame
+    //rate from the first block
+    startMicros_ = micros();
+    while (blocksIn_ - blocksOut_ < BETWEENER_RECORD_BLOCKS && loadBlock()){}
+    if (blocksIn_ == 0){
+        DEBUG_PRINTLN("there is no Betweener recording to play back there");
+        return false;
+    }
+    periodMicros_ = get32(blocks_[0] + 16);
+    if (periodMicros_ == 0) periodMicros_ = 1000;
+
+    active_ = this;
+    Betweener::shareDACWithTimers();
+    mode_ = MODE_PLAY;
+    if (!timer_.begin(timerISR, periodMicros_)){
+        DEBUG_PRINTLN("the recorder: all the hardware timers (IntervalTimers) are in use!");
+        mode_ = MODE_IDLE;
+        return false;
+    }
+    return true;
+}
+
+
+void BetweenerRecorder::stop(void){
+    timer_.end();
+    if (mode_ == MODE_RECORD){
+        //the timer is stopped, so nothing else touches the blocks now
+        if (blockOpen_) closeRecordBlock();
+        while (blocksOut_ != blocksIn_) saveBlock();
+    }
+    mode_ = MODE_IDLE;
+}
+
+
+void BetweenerRecorder::update(void){
+    if (mode_ == MODE_RECORD){
+        while (blocksOut_ != blocksIn_) saveBlock();
+    }else if (mode_ == MODE_PLAY){
+        while (!endOfData_ && blocksIn_ - blocksOut_ < BETWEENER_RECORD_BLOCKS){
+            if (!loadBlock()) break;
+        }
+    }
+}
+
+
+bool BetweenerRecorder::saveBlock(void){
+    const uint32_t start = micros();
+    const bool ok = storage_->writeBlock(blocks_[blocksOut_ % BETWEENER_RECORD_BLOCKS]);
+    const uint32_t took = micros() - start;
+    if (took > maxStorageMicros_) maxStorageMicros_ = took;
+    if (!ok) storageErrors_++;
+    //hand the block back to the timer either way; holding on to it would
+    //only make the recording stop too
+    blocksOut_ = blocksOut_ + 1;
+    blocksDone_++;
+    return ok;
+}
+
+
+bool BetweenerRecorder::loadBlock(void){
+    uint8_t *block = blocks_[blocksIn_ % BETWEENER_RECORD_BLOCKS];
+    const uint32_t start = micros();
+    const bool ok = storage_->readBlock(block);
+    const uint32_t took = micros() - start;
+    if (took > maxStorageMicros_) maxStorageMicros_ = took;
+
+    if (!ok || block[0] != 'B' || block[1] != 'R' || block[2] != BETWEENER_RECORD_VERSION){
+        //the end of the recording (or something that is not one)
+        endOfData_ = true;
+        return false;
+    }
+    encodedBytes_ += get16(block + 20) - HEADER_SIZE;
+    encodedFrames_ += get16(block + 6);
+    blocksIn_ = blocksIn_ + 1;
+    blocksDone_++;
+    return true;
+}
+
+
+uint32_t BetweenerRecorder::bytesPerSecond(void){
+    const uint32_t elapsed = micros() - startMicros_;
+    if (elapsed == 0) return 0;
+    return (uint32_t)((uint64_t)blocksDone_ * BETWEENER_RECORD_BLOCK_SIZE * 1000000 / elapsed);
+}
+
+
+float BetweenerRecorder::averageFrameBytes(void){
+    if (encodedFrames_ == 0) return 0;
+    return (float)encodedBytes_ / encodedFrames_;
+}
+
+
+////////////////////////////////////////////////////////////////////////
+//Everything below here runs inside the timer interrupt.
+
+bool BetweenerRecorder::openRecordBlock(const uint16_t *values, uint8_t triggers){
+    const uint32_t used = blocksIn_ - blocksOut_;
+    if (used >= BETWEENER_RECORD_BLOCKS) return false;
+    const int spare = BETWEENER_RECORD_BLOCKS - 1 - used;
+    if (spare < minFreeBlocks_) minFreeBlocks_ = spare;
+
+    uint8_t *block = blocks_[blocksIn_ % BETWEENER_RECORD_BLOCKS];
+    block[0] = 'B';
+    block[1] = 'R';
+    block[2] = BETWEENER_RECORD_VERSION;
+    block[3] = cvBits_;
+    block[4] = knobBits_;
+    block[5] = 0;
+    put32(block + 8, blockNumber_++);
+    put32(block + 12, frames_ + framesDropped_);
+    put32(block + 16, periodMicros_);
+    //the keyframe: every reading in full
+    block[HEADER_SIZE] = triggers;
+    for (int i = 0; i < 8; i++){
+        put16(block + HEADER_SIZE + 1 + 2 * i, values[i]);
+        values_[i] = values[i];
+    }
+    triggers_ = triggers;
+    blockPos_ = KEYFRAME_END;
+    blockFrames_ = 1;
+    blockOpen_ = true;
+    encodedBytes_ += KEYFRAME_END - HEADER_SIZE;
+    encodedFrames_++;
+    return true;
+}
+
+
+void BetweenerRecorder::closeRecordBlock(void){
+    uint8_t *block = blocks_[blocksIn_ % BETWEENER_RECORD_BLOCKS];
+    put16(block + 6, blockFrames_);
+    put16(block + 20, blockPos_);
+    memset(block + blockPos_, 0, BETWEENER_RECORD_BLOCK_SIZE - blockPos_);
+    blockOpen_ = false;
+    //now update() may write it
+    blocksIn_ = blocksIn_ + 1;
+}
+
+
+void BetweenerRecorder::captureFrame(void){
+    //read the inputs here rather than taking loop()'s snapshot: while
+    //update() is writing to the card, loop() reads nothing
+    uint16_t values[8];
+    uint8_t triggers;
+    b_.sampleInputsFromInterrupt(values, triggers);
+    triggers &= 0x0F;
+
+    if (blockOpen_){
+        //encode the changes since the last frame
+        uint8_t frame[MAX_FRAME_SIZE];
+        uint8_t mask = 0;
+        int n = 2;
+        for (int i = 0; i < 8; i++){
+            if (values[i] != values_[i]){
+                mask |= 1 << i;
+                n += putChange(frame + n, (int32_t)values[i] - values_[i]);
+            }
+        }
+        frame[0] = triggers;
+        if (mask){
+            frame[0] |= 0x10;
+            frame[1] = mask;
+        }else{
+            n = 1;
+        }
+
+        if (blockPos_ + n <= BETWEENER_RECORD_BLOCK_SIZE){
+            memcpy(blocks_[blocksIn_ % BETWEENER_RECORD_BLOCKS] + blockPos_, frame, n);
+            blockPos_ += n;
+            blockFrames_++;
+            encodedBytes_ += n;
+            encodedFrames_++;
+            for (int i = 0; i < 8; i++) values_[i] = values[i];
+            triggers_ = triggers;
+            frames_ = frames_ + 1;
+            return;
+        }
+        //no room: this frame starts the next block instead
+        closeRecordBlock();
+    }
+
+    if (openRecordBlock(values, triggers)){
+        frames_ = frames_ + 1;
+    }else{
+        framesDropped_ = framesDropped_ + 1;
+    }
+}
+
+
+void BetweenerRecorder::playFrame(void){
+    if (!blockOpen_){
+        if (blocksOut_ == blocksIn_){
+            if (endOfData_){
+                //played it all
+                mode_ = MODE_IDLE;
+                timer_.end();
+            }else{
+                underruns_ = underruns_ + 1;
+            }
+            return;
+        }
+        const int ahead = blocksIn_ - blocksOut_ - 1;
+        if (ahead < minFreeBlocks_) minFreeBlocks_ = ahead;
+
+        const uint8_t *block = blocks_[blocksOut_ % BETWEENER_RECORD_BLOCKS];
+        cvBits_ = block[3];
+        knobBits_ = block[4];
+        blockFrames_ = get16(block + 6);
+        if (blockFrames_ == 0) blockFrames_ = 1;  //a damaged header; play the keyframe only
+        triggers_ = block[HEADER_SIZE] & 0x0F;
+        for (int i = 0; i < 8; i++){
+            values_[i] = get16(block + HEADER_SIZE + 1 + 2 * i);
+        }
+        blockPos_ = KEYFRAME_END;
+        blockOpen_ = true;
+    }else{
+        const uint8_t *block = blocks_[blocksOut_ % BETWEENER_RECORD_BLOCKS];
+        const uint16_t end = min(get16(block + 20), (uint16_t)BETWEENER_RECORD_BLOCK_SIZE);
+        if (blockPos_ < end){
+            const uint8_t head = block[blockPos_++];
+            triggers_ = head & 0x0F;
+            if ((head & 0x10) && blockPos_ < end){
+                const uint8_t mask = block[blockPos_++];
+                for (int i = 0; i < 8; i++){
+                    if (mask & (1 << i)) values_[i] += getChange(block, blockPos_, end);
+                }
+            }
+        }
+    }
+    frames_ = frames_ + 1;
+    writeOutputs();
+
+    //that was the block's last frame: hand it back to update()
+    if (--blockFrames_ == 0){
+        blockOpen_ = false;
+        blocksOut_ = blocksOut_ + 1;
+    }
+}
+
+
+void BetweenerRecorder::writeOutputs(void){
+    for (int o = 0; o < 4; o++){
+        const int source = sources_[o];
+        if (source == BETWEENER_RECORD_NONE) continue;
+        int value;
+        if (source < BETWEENER_RECORD_TRIGGER1){
+            //scale the reading's bits to the DAC's 12
+            const int bits = (source < BETWEENER_RECORD_KNOB1) ? cvBits_ : knobBits_;
+            value = (bits >= 12) ? values_[source] >> (bits - 12) : values_[source] << (12 - bits);
+            if (value > 4095) value = 4095;
+        }else{
+            value = (triggers_ & (1 << (source - BETWEENER_RECORD_TRIGGER1))) ? 4095 : 0;
+        }
+        //skip the SPI message when nothing changed
+        if (value != lastOut_[o]){
+            Betweener::writeCVOut(o + 1, value);
+            lastOut_[o] = value;
+        }
+    }
+}
+
+
+void BetweenerRecorder::timerISR(void){
+    BetweenerRecorder *self = active_;
+    if (!self) return;
+    if (self->mode_ == MODE_RECORD){
+        self->captureFrame();
+    }else if (self->mode_ == MODE_PLAY){
+        self->playFrame();
+    }
+}
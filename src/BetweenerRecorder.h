@@ -0,0 +1,244 @@
+//
+//  BetweenerRecorder.h
+//
+//  Copyright (c) 2018 Kathryn Schaffer
+
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////
+//  BetweenerRecorder.h detailed description:
+//
+//  This file defines BetweenerRecorder, which records what happens on the
+//  Betweener's inputs (CV ins, knobs and triggers) to an SD card or SPI
+//  flash chip, and plays a recording back out of the CV outs.
+//
+//  Recording:  a timer takes a "frame" (all 8 analog readings plus the
+//  triggers) at a steady rate you choose, and packs it into a 512 byte
+//  block in RAM.  The timer does the reading itself, so frames keep
+//  coming while loop() is stuck writing to the card.  The readings are
+//  the raw ones (as readCVRaw and readKnobRaw give, with the bits and
+//  averaging set by setCVAcquisition and setKnobAcquisition), and the
+//  triggers are not debounced.  Reading 8 inputs takes time: about
+//  100 microseconds with the default settings, so 1000 frames a second
+//  uses around a tenth of the processor.  When a block is full, the
+//  timer moves on to the next one, and your loop() calls update(), which
+//  writes full blocks to the card.  Writing to an SD card sometimes takes
+//  much longer than usual (it is busy tidying itself up), so there are
+//  several blocks (BETWEENER_RECORD_BLOCKS) to soak that up while the
+//  timer carries on recording.  If they all fill up anyway, frames are
+//  dropped (and counted) rather than ever making the timer wait.
+//
+//  Playback works the other way around: update() reads blocks ahead into
+//  RAM, and the timer unpacks one frame at a time and writes it to the CV
+//  outs.  By default CV in 1-4 play out of CV out 1-4; setOutput() can
+//  send any recorded knob, CV or trigger to any output instead.  Readings
+//  are scaled to the 0-4095 of the CV outs; triggers become 0 or 4095.
+//
+//  The format is small: each 512 byte block starts with a header and one
+//  complete frame (a "keyframe"), and every frame after that only stores
+//  how much each reading changed, in as few bytes as that needs (one byte
+//  for a frame where nothing changed).  Because every block starts fresh,
+//  a damaged block does not spoil the rest of the recording.
+//      block offset  size  contents
+//        0           2     'B' 'R'
+//        2           1     format version (1)
+//        3           1     bits in the CV readings
+//        4           1     bits in the knob readings
+//        5           1     (unused, 0)
+//        6           2     frames in this block, including the keyframe
+//        8           4     block number, counting from 0
+//       12           4     number of the block's first frame in the recording
+//       16           4     microseconds between frames
+//       20           2     bytes of the block in use
+//       22           1     keyframe: triggers (bit 0 = trigger 1, 1 = high)
+//       23          16     keyframe: CV in 1-4, knobs 1-4
+//       39           -     the other frames, each:
+//                            1 byte: triggers in the low 4 bits; bit 4 set
+//                                    if any analog reading changed, then
+//                            1 byte: which of the 8 readings changed, then
+//                            for each of those, the change, "zigzag"
+//                            encoded (0, -1, 1, -2, 2... become 0, 1, 2,
+//                            3, 4...) and written 7 bits per byte, with
+//                            the top bit set on all but the last byte
+//  Numbers are little-endian.
+//
+//  Storage:  the recorder does not depend on the SD or SerialFlash
+//  libraries itself.  You open the file with whichever you use and wrap
+//  it in a BetweenerFileStorage:
+//      File file = SD.open("take1.rec", FILE_WRITE);
+//      BetweenerFileStorage<File> storage(file);
+//      recorder.record(storage, 1000);   //1000 frames per second
+//  The Audio shield's SD card is on the same SPI pins as the DACs, with
+//  chip select 10, so SD.begin(10) after b.begin() is all it needs.
+//
+//  Since SD and the DACs share the SPI bus, a playback frame that comes
+//  due while update() is reading from the card waits until the card is
+//  done, so playback timing can wobble by that much.  The numbers below
+//  tell you how close to the limit your settings are:
+//      minFreeBlocks()    the fewest spare RAM blocks there have been
+//                         (0 means it came close to dropping frames)
+//      maxStorageMicros() the longest a single block write/read took
+//      bytesPerSecond()   the data rate to or from the card
+//      averageFrameBytes() how well the frames pack
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef BetweenerRecorder_h
+#define BetweenerRecorder_h
+
+#include <Arduino.h>
+#include "Betweener.h"
+
+#define BETWEENER_RECORD_BLOCK_SIZE 512
+#define BETWEENER_RECORD_BLOCKS 4      //RAM blocks between the timer and the card; a power of two
+#define BETWEENER_RECORD_VERSION 1
+
+//what a CV out plays back, for setOutput()
+#define BETWEENER_RECORD_NONE -1
+#define BETWEENER_RECORD_CV1 0       //... CV2 to CV4 are 1 to 3
+#define BETWEENER_RECORD_KNOB1 4     //... KNOB2 to KNOB4 are 5 to 7
+#define BETWEENER_RECORD_TRIGGER1 8  //... TRIGGER2 to TRIGGER4 are 9 to 11
+
+
+//Where recordings go.  update() calls these from loop(), one whole block
+//at a time.  They return false when the block could not be written (card
+//full...) or read (end of the recording).
+class BetweenerRecordStorage
+{
+    public:
+    virtual bool writeBlock(const uint8_t *block) = 0;
+    virtual bool readBlock(uint8_t *block) = 0;
+};
+
+//Storage in an open file of any library whose files have read(buffer,
+//count) and write(buffer, count): SD's File and SerialFlash's
+//SerialFlashFile both do.
+template<class FileType>
+class BetweenerFileStorage : public BetweenerRecordStorage
+{
+    public:
+    BetweenerFileStorage(FileType &file) : file_(file) {}
+    bool writeBlock(const uint8_t *block){
+        return file_.write(block, BETWEENER_RECORD_BLOCK_SIZE) == BETWEENER_RECORD_BLOCK_SIZE;
+    };
+    bool readBlock(uint8_t *block){
+        return (int)file_.read(block, BETWEENER_RECORD_BLOCK_SIZE) == BETWEENER_RECORD_BLOCK_SIZE;
+    };
+
+    private:
+    FileType &file_;
+};
+
+
+class BetweenerRecorder
+{
+    public:
+
+    BetweenerRecorder(Betweener &b);
+
+    //start recording into 'storage' / playing back from it.  play()
+    //returns false if the storage does not start with a recording, and
+    //both return false if no hardware timer was free.
+    bool record(BetweenerRecordStorage &storage, float framesPerSecond);
+    bool play(BetweenerRecordStorage &storage);
+    //stops either one.  When recording, this writes out what is left in
+    //RAM, so it can take a few milliseconds; close the file afterwards.
+    void stop(void);
+
+    //moves blocks between RAM and the storage.  Call it from loop() as
+    //often as you can while recording or playing.
+    void update(void);
+
+    bool recording(void){ return mode_ == MODE_RECORD; };
+    bool playing(void){ return mode_ == MODE_PLAY; };  //becomes false at the end of the recording
+
+    //choose what CV out 1-4 plays back: one of the BETWEENER_RECORD_
+    //numbers above, e.g. setOutput(1, BETWEENER_RECORD_KNOB1 + 2) plays knob 3
+    void setOutput(int cvout, int source);
+
+    uint32_t frames(void){ return frames_; };               //recorded, or played
+    uint32_t framesDropped(void){ return framesDropped_; }; //lost: no RAM block free
+    uint32_t underruns(void){ return underruns_; };         //playback frames late: no block read yet
+    uint32_t blocks(void){ return blocksDone_; };           //written, or read
+    uint32_t storageErrors(void){ return storageErrors_; };
+    int minFreeBlocks(void){ return minFreeBlocks_; };
+    uint32_t maxStorageMicros(void){ return maxStorageMicros_; };
+    uint32_t bytesPerSecond(void);
+    float averageFrameBytes(void);
+
+
+    private:
+
+    enum { MODE_IDLE, MODE_RECORD, MODE_PLAY };
+
+    void captureFrame(void);
+    void playFrame(void);
+    bool openRecordBlock(const uint16_t *values, uint8_t triggers);
+    void closeRecordBlock(void);
+    bool loadBlock(void);
+    bool saveBlock(void);
+    void writeOutputs(void);
+
+    static void timerISR(void);
+    static BetweenerRecorder *active_;
+
+    Betweener &b_;
+    BetweenerRecordStorage *storage_ = NULL;
+    IntervalTimer timer_;
+    volatile uint8_t mode_ = MODE_IDLE;
+    uint32_t periodMicros_ = 1000;
+
+    uint8_t blocks_[BETWEENER_RECORD_BLOCKS][BETWEENER_RECORD_BLOCK_SIZE];
+    //free-running counts, like the telemetry queue: blocks filled by the
+    //timer (recording) or loaded by update() (playback)...
+    volatile uint32_t blocksIn_ = 0;
+    //...and blocks written out by update() (recording) or used up by the
+    //timer (playback).  The blocks in between are the ones in use.
+    volatile uint32_t blocksOut_ = 0;
+
+    //the block the timer is working on
+    bool blockOpen_ = false;
+    uint16_t blockPos_ = 0;
+    uint16_t blockFrames_ = 0;
+    uint32_t blockNumber_ = 0;
+
+    //the frame most recently recorded or played
+    uint16_t values_[8];
+    uint8_t triggers_ = 0;
+    uint8_t cvBits_ = 10;
+    uint8_t knobBits_ = 10;
+    int8_t sources_[4] = {BETWEENER_RECORD_CV1, BETWEENER_RECORD_CV1 + 1, BETWEENER_RECORD_CV1 + 2, BETWEENER_RECORD_CV1 + 3};
+    int lastOut_[4];
+    volatile bool endOfData_ = false;
+
+    volatile uint32_t frames_ = 0;
+    volatile uint32_t framesDropped_ = 0;
+    volatile uint32_t underruns_ = 0;
+    uint32_t blocksDone_ = 0;
+    uint32_t storageErrors_ = 0;
+    volatile int minFreeBlocks_ = BETWEENER_RECORD_BLOCKS;
+    uint32_t maxStorageMicros_ = 0;
+    uint32_t startMicros_ = 0;
+    uint64_t encodedBytes_ = 0;  //frame bytes, not counting block headers and padding
+    uint32_t encodedFrames_ = 0; //frames those bytes hold
+};
+
+
+#endif /* BetweenerRecorder_h */
@@ -0,0 +1,207 @@
+//
+//  BetweenerSampleHold.cpp
+//
+//  Copyright (c) 2018 Kathryn Schaffer
+
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+//  BetweenerSampleHold.cpp detailed description:
+//
+//  Implementation of BetweenerSampleHold.  See BetweenerSampleHold.h for
+//  how to use it.  sample() and the ISRs at the bottom run inside the
+//  trigger interrupts and are kept short on purpose.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "BetweenerSampleHold.h"
+
+BetweenerSampleHold * BetweenerSampleHold::active_ = NULL;
+
+
+BetweenerSampleHold::BetweenerSampleHold(Betweener &b) : b_(b){
+    for (int i = 0; i < 4; i++){
+        routes_[i].cvIn = 0;
+        routes_[i].cvOut = 1;
+        routes_[i].quantize = false;
+        routes_[i].held = 0;
+        routes_[i].samples = 0;
+    }
+    scale_ = BETWEENER_SCALE_CHROMATIC;
+    averaging_ = 1;
+    resetStats();
+}
+
+
+bool BetweenerSampleHold::validTrigger(int trigger){
+    if (trigger < 1 || trigger > 4){
+        DEBUG_PRINTLN("you are trying to use a nonexistent trigger!");
+        return false;
+    }
+    return true;
+}
+
+
+void BetweenerSampleHold::attach(int trigger, int cvIn, int cvOut, bool quantize){
+    if (!validTrigger(trigger)) return;
+    if (cvIn < 1 || cvIn > 4 || cvOut < 1 || cvOut > 4){
+        DEBUG_PRINTLN("the sample and hold needs a CV input and a CV out, 1 to 4");
+        return;
+    }
+    active_ = this;
+
+    //the cycle counter, for the latency
+    ARM_DEMCR |= ARM_DEMCR_TRCENA;
+    ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+
+    const uint8_t pin = BETWEENER_BOARD.triggerPins[trigger - 1];
+    detachInterrupt(pin);
+    Route &r = routes_[trigger - 1];
+    r.cvIn = cvIn;
+    r.cvOut = cvOut;
+    r.quantize = quantize;
+
+    //the DACs get written from this pin's interrupt
+    Betweener::shareDACWithPin(pin);
+
+    //the trigger inputs are inverted by the hardware, so the trigger
+    //going high is the pin falling
+    void (*isrs[4])(void) = {triggerISR1, triggerISR2, triggerISR3, triggerISR4};
+    attachInterrupt(pin, isrs[trigger - 1], FALLING);
+}
+
+
+void BetweenerSampleHold::detach(int trigger){
+    if (!validTrigger(trigger)) return;
+    detachInterrupt(BETWEENER_BOARD.triggerPins[trigger - 1]);
+    routes_[trigger - 1].cvIn = 0;
+}
+
+
+void BetweenerSampleHold::detachAll(void){
+    for (int t = 1; t <= 4; t++){
+        if (routes_[t - 1].cvIn) detach(t);
+    }
+}
+
+
+void BetweenerSampleHold::setScale(uint16_t notes){
+    scale_ = notes & BETWEENER_SCALE_CHROMATIC;
+}
+
+
+void BetweenerSampleHold::setHardwareAveraging(int n){
+    if (n != 1 && n != 4 && n != 8 && n != 16 && n != 32){
+        DEBUG_PRINTLN("hardware averaging can be 1, 4, 8, 16 or 32");
+        return;
+    }
+    averaging_ = n;
+}
+
+
+int BetweenerSampleHold::held(int trigger){
+    if (!validTrigger(trigger)) return -1;
+    return routes_[trigger - 1].held;
+}
+
+
+uint32_t BetweenerSampleHold::samples(int trigger){
+    if (!validTrigger(trigger)) return 0;
+    return routes_[trigger - 1].samples;
+}
+
+
+void BetweenerSampleHold::resetStats(void){
+    latencyLast_ = 0;
+    latencyMax_ = 0;
+    latencyMin_ = 0xFFFFFFFF;
+}
+
+
+int BetweenerSampleHold::quantize(int code){
+    const uint16_t scale = scale_;
+    if (scale == 0) return code;  //no notes allowed: leave it alone
+
+    //the note nearest to the voltage, then the nearest one to that which
+    //is in the scale (a scale always has one within 11 semitones)
+    const int nearest = (code * BETWEENER_SEQ_MAX_NOTE + 2047) / 4095;
+    int best = -1;
+    int bestDistance = 0x7FFF;
+    for (int d = 0; d < 12; d++){
+        const int candidates[2] = {nearest - d, nearest + d};
+        for (int c = 0; c < 2; c++){
+            const int note = candidates[c];
+            if (note < 0 || note > BETWEENER_SEQ_MAX_NOTE) continue;
+            if (!(scale & (1 << (note % 12)))) continue;
+            const int distance = abs((int)BetweenerSequencer::noteToCV(note) - code);
+            if (distance < bestDistance){
+                best = note;
+                bestDistance = distance;
+            }
+        }
+        //anything further out is further away still
+        if (best >= 0) break;
+    }
+    return (best >= 0) ? BetweenerSequencer::noteToCV(best) : code;
+}
+
+
+////////////////////////////////////////////////////////////////////////
+//Everything below here runs inside interrupts.
+
+void BetweenerSampleHold::sample(int i){
+    const uint32_t start = ARM_DWT_CYCCNT;
+    Route &r = routes_[i];
+    if (!r.cvIn) return;
+
+    //borrow the ADC with our own averaging, and put back the library's.
+    //If loop() was in the middle of an analogRead, the Teensy notices
+    //that we used the ADC and starts its reading again.
+    const uint8_t theirs = Betweener::adcAveraging;
+    if (averaging_ != theirs) analogReadAveraging(averaging_);
+    const int reading = analogRead(BETWEENER_BOARD.cvInPins[r.cvIn - 1]);
+    if (averaging_ != theirs) analogReadAveraging(theirs);
+
+    //to the DACs' 12 bits.  Shorter readings get their top bits repeated
+    //at the bottom, so the largest reading becomes 4095, not 4092.
+    //(the bits are read here, not at attach(), so setADCResolution can
+    //change them at any time)
+    const int adcBits = b_.ADCBits();
+    int code;
+    if (adcBits >= 12){
+        code = reading >> (adcBits - 12);
+    }else{
+        code = (reading << (12 - adcBits)) | (reading >> (2 * adcBits - 12));
+    }
+    if (r.quantize) code = quantize(code);
+
+    Betweener::writeCVOut(r.cvOut, code);
+    r.held = code;
+    r.samples = r.samples + 1;
+
+    const uint32_t cycles = ARM_DWT_CYCCNT - start;
+    latencyLast_ = cycles;
+    if (cycles > latencyMax_) latencyMax_ = cycles;
+    if (cycles < latencyMin_) latencyMin_ = cycles;
+}
+
+
+void BetweenerSampleHold::triggerISR1(void){ if (active_) active_->sample(0); }
+void BetweenerSampleHold::triggerISR2(void){ if (active_) active_->sample(1); }
+void BetweenerSampleHold::triggerISR3(void){ if (active_) active_->sample(2); }
+void BetweenerSampleHold::triggerISR4(void){ if (active_) active_->sample(3); }
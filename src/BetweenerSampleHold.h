@@ -0,0 +1,155 @@
+//
+//  BetweenerSampleHold.h
+//
+//  Copyright (c) 2018 Kathryn Schaffer
+
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////
+//  BetweenerSampleHold.h detailed description:
+//
+//  This file defines BetweenerSampleHold, a sample and hold that runs
+//  inside the trigger interrupts instead of in loop().
+//
+//  The usual way to sample and hold in a sketch is
+//      if (b.triggerRose(1)) b.writeCVOut(1, b.readCV(1) * 4);
+//  which works, but the voltage it holds is not the one that was there
+//  when the trigger arrived.  loop() only notices the trigger the next
+//  time it gets round to reading it, and readCV() is smoothed, so it lags
+//  a fast-moving CV even more.  For slow modulation that does not matter;
+//  for sampling an envelope or a sequencer's pitch on a clock it does.
+//
+//  BetweenerSampleHold instead attaches an interrupt to the trigger pin.
+//  The moment the trigger goes high, the interrupt converts the CV input
+//  you chose (one raw conversion, no smoothing, no averaging by default),
+//  optionally snaps it to the nearest note of a scale, and writes it to
+//  the CV out you chose.  On a Teensy 3.2 that takes a few microseconds,
+//  and the library measures exactly how many: latencyCycles() is the
+//  time from the interrupt starting to the DAC having been written, in
+//  processor cycles (96 per microsecond at 96 MHz).  The hardware itself
+//  adds well under a microsecond before the interrupt starts, and if
+//  loop() happens to be writing a DAC at that moment, the interrupt waits
+//  for that write (a few microseconds) to finish.
+//
+//  Each trigger input can hold its own CV input on its own CV out, so
+//  you can have up to four sample and holds.  The CV input and the CV out
+//  are scaled so the same voltage comes back out (0-5V in gives 0-5V out).
+//
+//  Quantizing treats the voltage as 1V/octave with 0V as C, like the
+//  sequencer, and picks the nearest note that is in the scale you set
+//  with setScale().
+//
+//  Example:
+//      Betweener b;
+//      BetweenerSampleHold sh(b);
+//      void setup(){
+//          b.begin();
+//          sh.attach(1, 1, 1, true);  //trigger 1 holds CV in 1 on CV out 1, quantized
+//          sh.attach(2, 2, 2);        //trigger 2 holds CV in 2 on CV out 2, as it is
+//      }
+//      void loop(){ ... }  //nothing needed here; it all happens in the background
+//
+//  The ADC is shared with the rest of the library: the interrupt simply
+//  borrows it, and if loop() was in the middle of a reading the Teensy
+//  starts that reading again afterwards.  It cannot be used together with
+//  AudioInputBetweenerCV, which keeps the ADC to itself.  And like the
+//  sequencer clock, each trigger pin can only have one interrupt, so do
+//  not also attach the sequencer (or BetweenerIdle) to the same trigger.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef BetweenerSampleHold_h
+#define BetweenerSampleHold_h
+
+#include <Arduino.h>
+#include "Betweener.h"
+#include "BetweenerSequencer.h"
+
+#define BETWEENER_SCALE_CHROMATIC 0x0FFF  //all 12 notes
+#define BETWEENER_SCALE_MAJOR 0x0AB5      //C D E F G A B
+#define BETWEENER_SCALE_MINOR 0x05AD      //C D Eb F G Ab Bb
+#define BETWEENER_SCALE_PENTATONIC 0x0295 //C D E G A
+
+
+class BetweenerSampleHold
+{
+    public:
+
+    BetweenerSampleHold(Betweener &b);
+
+    //from now on, each time trigger 'trigger' goes high, sample CV input
+    //'cvIn' and hold it on CV out 'cvOut'.  All three are 1-4.
+    void attach(int trigger, int cvIn, int cvOut, bool quantize = false);
+    void detach(int trigger);
+    void detachAll(void);
+
+    //which notes quantizing may pick: bit 0 is C, bit 1 C#... bit 11 B.
+    //E.g. BETWEENER_SCALE_MAJOR.  Affects every quantized trigger.
+    void setScale(uint16_t notes);
+
+    //conversions the ADC averages for each sample: 1 (the default, the
+    //fastest), 4, 8, 16 or 32.  More is less noisy but each one adds a
+    //conversion time to the latency.
+    void setHardwareAveraging(int n);
+
+    int held(int trigger);           //the DAC code (0-4095) held now
+    uint32_t samples(int trigger);   //how many times this trigger sampled
+
+    //interrupt start to DAC written, in cycles, over all triggers
+    uint32_t latencyCycles(void){ return latencyLast_; };     //the last sample
+    uint32_t latencyMaxCycles(void){ return latencyMax_; };   //the worst so far
+    uint32_t latencyMinCycles(void){ return latencyMin_; };   //the best so far
+    void resetStats(void);
+
+    //the nearest DAC code to 'code' that is a note of the scale
+    int quantize(int code);
+
+
+    private:
+
+    struct Route {
+        uint8_t cvIn;     //1-4, 0 = this trigger is not attached
+        uint8_t cvOut;    //1-4
+        bool quantize;
+        volatile uint16_t held;
+        volatile uint32_t samples;
+    };
+
+    bool validTrigger(int trigger);
+    void sample(int i);
+
+    static void triggerISR1(void);
+    static void triggerISR2(void);
+    static void triggerISR3(void);
+    static void triggerISR4(void);
+
+    static BetweenerSampleHold *active_;
+
+    Betweener &b_;
+    Route routes_[4];
+    volatile uint16_t scale_;
+    uint8_t averaging_;
+
+    volatile uint32_t latencyLast_;
+    volatile uint32_t latencyMax_;
+    volatile uint32_t latencyMin_;
+};
+
+
+#endif /* BetweenerSampleHold_h */
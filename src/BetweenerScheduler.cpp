@@ -0,0 +1,300 @@
+//
+//  BetweenerScheduler.cpp
+//
+//  Copyright (c) 2018 Kathryn Schaffer
+
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+//  BetweenerScheduler.cpp detailed description:
+//
+//  Implementation of BetweenerScheduler.  See BetweenerScheduler.h for how
+//  to use it.
+//
+//  All the times are micros() values, which wrap round every 71 minutes,
+//  so they are always compared by subtracting and looking at the sign of
+//  the difference, never directly with < or >.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "BetweenerScheduler.h"
+
+
+BetweenerScheduler::BetweenerScheduler(void){
+    for (int i = 0; i < BETWEENER_SCHED_TASKS; i++){
+        tasks_[i].function = NULL;
+    }
+    //the clock starts with the first addTask() or run(), not here: a
+    //global scheduler is built long before setup() is done
+    elapsed_ = 0;
+    statsLast_ = 0;
+    statsStarted_ = false;
+}
+
+
+bool BetweenerScheduler::validTask(int task){
+    if (task < 0 || task >= BETWEENER_SCHED_TASKS || !tasks_[task].function){
+        DEBUG_PRINTLN("you are trying to use a nonexistent scheduler task!");
+        return false;
+    }
+    return true;
+}
+
+
+int BetweenerScheduler::addTask(void (*function)(void *), void *arg, uint32_t periodMicros,
+                                uint32_t deadlineMicros, int priority, const char *name){
+    if (!function) return -1;
+    countTime();
+    for (int i = 0; i < BETWEENER_SCHED_TASKS; i++){
+        Task &t = tasks_[i];
+        if (t.function) continue;
+
+        //the cycle counter, for the time each task takes
+        ARM_DEMCR |= ARM_DEMCR_TRCENA;
+        ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+
+        t.function = function;
+        t.arg = arg;
+        t.name = name ? name : "";
+        t.period = periodMicros;
+        t.deadline = deadlineMicros ? deadlineMicros : periodMicros;
+        t.priority = constrain(priority, -128, 127);
+        t.enabled = true;
+        t.release = micros();
+        t.runs = 0;
+        t.misses = 0;
+        t.skipped = 0;
+        t.maxCycles = 0;
+        t.busyCycles = 0;
+        return i;
+    }
+    DEBUG_PRINTLN("the scheduler is full!");
+    return -1;
+}
+
+
+void BetweenerScheduler::removeTask(int task){
+    if (!validTask(task)) return;
+    tasks_[task].function = NULL;
+}
+
+
+void BetweenerScheduler::setPeriod(int task, uint32_t periodMicros){
+    if (!validTask(task)) return;
+    Task &t = tasks_[task];
+    //a deadline that was "one period" follows the period
+    if (t.deadline == t.period) t.deadline = periodMicros;
+    t.period = periodMicros;
+}
+
+
+void BetweenerScheduler::setEnabled(int task, bool enabled){
+    if (!validTask(task)) return;
+    Task &t = tasks_[task];
+    //coming back on, it is due straight away rather than catching up
+    if (enabled && !t.enabled) t.release = micros();
+    t.enabled = enabled;
+}
+
+
+#if BETWEENER_USE_TRIGGERS
+int BetweenerScheduler::addReadTriggers(Betweener &b, uint32_t periodMicros, int priority){
+    return addTask(readTriggersTask, &b, periodMicros, 0, priority, "triggers");
+}
+void BetweenerScheduler::readTriggersTask(void *b){ ((Betweener *)b)->readTriggers(); }
+#endif
+
+#if BETWEENER_USE_ANALOG_INPUTS
+int BetweenerScheduler::addReadCVs(Betweener &b, uint32_t periodMicros, int priority){
+    return addTask(readCVsTask, &b, periodMicros, 0, priority, "CVs");
+}
+
+int BetweenerScheduler::addReadKnobs(Betweener &b, uint32_t periodMicros, int priority){
+    return addTask(readKnobsTask, &b, periodMicros, 0, priority, "knobs");
+}
+void BetweenerScheduler::readCVsTask(void *b){ ((Betweener *)b)->readCVs(); }
+void BetweenerScheduler::readKnobsTask(void *b){ ((Betweener *)b)->readKnobs(); }
+#endif
+
+#if BETWEENER_USE_USB_MIDI
+int BetweenerScheduler::addReadUsbMIDI(Betweener &b, uint32_t periodMicros, int priority){
+    return addTask(readUsbMIDITask, &b, periodMicros, 0, priority, "USB MIDI");
+}
+void BetweenerScheduler::readUsbMIDITask(void *b){ ((Betweener *)b)->readUsbMIDI(); }
+#endif
+
+
+bool BetweenerScheduler::due(const Task &t, uint32_t now){
+    return t.function && t.enabled && (int32_t)(now - t.release) >= 0;
+}
+
+
+int BetweenerScheduler::run(void){
+    countTime();
+    uint32_t ran = 0;  //bit i: task i already ran this time
+    int count = 0;
+
+    //pick the most urgent task that is due, run it, and look again (a
+    //task that took long may have made others due in the meantime)
+    while (true){
+        const uint32_t now = micros();
+        int pick = -1;
+        for (int i = 0; i < BETWEENER_SCHED_TASKS; i++){
+            const Task &t = tasks_[i];
+            if ((ran & (1UL << i)) || !due(t, now)) continue;
+            if (pick < 0){
+                pick = i;
+                continue;
+            }
+            const Task &p = tasks_[pick];
+            if (t.priority != p.priority){
+                if (t.priority > p.priority) pick = i;
+            }else if ((int32_t)((t.release + t.deadline) - (p.release + p.deadline)) < 0){
+                pick = i;
+            }
+        }
+        if (pick < 0) break;
+        ran |= 1UL << pick;
+        runTask(tasks_[pick]);
+        count++;
+    }
+    return count;
+}
+
+
+void BetweenerScheduler::runTask(Task &t){
+    const uint32_t start = ARM_DWT_CYCCNT;
+    t.function(t.arg);
+    const uint32_t cycles = ARM_DWT_CYCCNT - start;
+    const uint32_t finish = micros();
+
+    t.runs++;
+    t.busyCycles += cycles;
+    if (cycles > t.maxCycles) t.maxCycles = cycles;
+    if (t.deadline && (int32_t)(finish - (t.release + t.deadline)) > 0) t.misses++;
+
+    if (t.period == 0){
+        t.release = finish;
+        return;
+    }
+    //the next one is due a period after this one was, so the rate stays
+    //steady even if this run was late.  But if it is so late that further
+    //periods have already gone by, skip those instead of running it
+    //several times in a row to catch up.
+    t.release += t.period;
+    if ((int32_t)(finish - t.release) >= 0){
+        const uint32_t behind = (finish - t.release) / t.period;
+        t.skipped += behind;
+        t.release += behind * t.period;
+    }
+}
+
+
+uint32_t BetweenerScheduler::microsUntilNext(void){
+    const uint32_t now = micros();
+    uint32_t soonest = 0xFFFFFFFF;
+    for (int i = 0; i < BETWEENER_SCHED_TASKS; i++){
+        const Task &t = tasks_[i];
+        if (!t.function || !t.enabled) continue;
+        const int32_t wait = (int32_t)(t.release - now);
+        if (wait <= 0) return 0;
+        if ((uint32_t)wait < soonest) soonest = wait;
+    }
+    return soonest;
+}
+
+
+void BetweenerScheduler::countTime(void){
+    const uint32_t now = micros();
+    if (statsStarted_) elapsed_ += now - statsLast_;
+    statsStarted_ = true;
+    statsLast_ = now;
+}
+
+
+uint32_t BetweenerScheduler::runs(int task){
+    return validTask(task) ? tasks_[task].runs : 0;
+}
+
+uint32_t BetweenerScheduler::deadlineMisses(int task){
+    return validTask(task) ? tasks_[task].misses : 0;
+}
+
+uint32_t BetweenerScheduler::skippedPeriods(int task){
+    return validTask(task) ? tasks_[task].skipped : 0;
+}
+
+uint32_t BetweenerScheduler::maxCycles(int task){
+    return validTask(task) ? tasks_[task].maxCycles : 0;
+}
+
+
+float BetweenerScheduler::cpuShare(int task){
+    if (!validTask(task)) return 0;
+    countTime();
+    if (elapsed_ == 0) return 0;
+    return (float)tasks_[task].busyCycles / ((float)elapsed_ * (F_CPU / 1000000));
+}
+
+
+float BetweenerScheduler::idleShare(void){
+    float busy = 0;
+    for (int i = 0; i < BETWEENER_SCHED_TASKS; i++){
+        if (tasks_[i].function) busy += cpuShare(i);
+    }
+    return (busy < 1) ? 1 - busy : 0;
+}
+
+
+void BetweenerScheduler::resetStats(void){
+    for (int i = 0; i < BETWEENER_SCHED_TASKS; i++){
+        Task &t = tasks_[i];
+        t.runs = 0;
+        t.misses = 0;
+        t.skipped = 0;
+        t.maxCycles = 0;
+        t.busyCycles = 0;
+    }
+    elapsed_ = 0;
+    statsLast_ = micros();
+    statsStarted_ = true;
+}
+
+
+void BetweenerScheduler::printStats(Print &out){
+    out.println("task        runs\tmissed\tskipped\tmax us\tcpu %");
+    for (int i = 0; i < BETWEENER_SCHED_TASKS; i++){
+        const Task &t = tasks_[i];
+        if (!t.function) continue;
+        //the name padded to 12 characters, then the numbers tab separated
+        out.print(t.name);
+        for (int n = strlen(t.name); n < 12; n++) out.print(" ");
+        out.print(t.runs);
+        out.print("\t");
+        out.print(t.misses);
+        out.print("\t");
+        out.print(t.skipped);
+        out.print("\t");
+        out.print(t.maxCycles / (F_CPU / 1000000));
+        out.print("\t");
+        out.println(cpuShare(i) * 100, 1);
+    }
+    out.print("(outside tasks: ");
+    out.print(idleShare() * 100, 1);
+    out.println(" %)");
+}
@@ -0,0 +1,185 @@
+//
+//  BetweenerScheduler.h
+//
+//  Copyright (c) 2018 Kathryn Schaffer
+
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////
+//  BetweenerScheduler.h detailed description:
+//
+//  This file defines BetweenerScheduler, which runs the parts of your
+//  sketch each at its own pace instead of all of them on every loop().
+//
+//  A sketch that calls b.readAllInputs() in loop() reads all four
+//  triggers, eight analog inputs and USB MIDI every single time round,
+//  as fast as it can.  But a knob turned by hand only needs reading
+//  100 times a second, while a CV carrying an envelope may need 2000,
+//  and MIDI should be picked up as soon as it arrives.  Reading the knobs
+//  20 times more often than needed takes processor time away from the
+//  things that are in a hurry.
+//
+//  With the scheduler you split the work into "tasks", each with:
+//    - a function to call (with a pointer you choose handed to it)
+//    - a period: how often to call it, in microseconds (0 = every time)
+//    - a deadline: how soon after it became due it must have finished,
+//      in microseconds (0 = one period)
+//    - a priority: when several tasks are due at once, the bigger number
+//      goes first; between equal priorities, the nearest deadline goes first
+//  and loop() just calls run(), which calls each task that is due.
+//
+//  The tasks take turns ("cooperative" scheduling): nothing interrupts a
+//  task, so a task that takes long makes the others late.  The scheduler
+//  keeps count, for each task, of the deadlines it missed, the periods
+//  it had to skip because it was too late to catch up, the longest time
+//  it took, and its share of the processor, so you can see where the
+//  time goes.  printStats() prints all that as a table.
+//
+//  There are ready-made tasks for the Betweener's own read functions
+//  (readTriggers, readCVs, readKnobs and readUsbMIDI).  Note that edges
+//  like triggerRose() and changes like CVChanged() are only updated when
+//  the read task runs, so check them in a task of your own that runs
+//  at the same period, rather than on every loop().
+//
+//  Example:
+//      Betweener b;
+//      BetweenerScheduler sched;
+//      void react(void *arg){ if (b.triggerRose(1)) ... }
+//      void setup(){
+//          b.begin();
+//          sched.addReadTriggers(b, 1000);     //1 kHz
+//          sched.addReadCVs(b, 500);           //2 kHz
+//          sched.addReadKnobs(b, 10000);       //100 Hz
+//          sched.addReadUsbMIDI(b);            //every time round
+//          sched.addTask(react, NULL, 1000, 0, 2, "react");
+//      }
+//      void loop(){ sched.run(); }
+//
+//  To let the processor sleep until the next task is due, end loop()
+//  with BetweenerIdle::idle(sched.microsUntilNext()).
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef BetweenerScheduler_h
+#define BetweenerScheduler_h
+
+#include <Arduino.h>
+#include "Betweener.h"
+
+#define BETWEENER_SCHED_TASKS 8  //the most tasks one scheduler holds
+
+//the priorities the ready-made tasks get unless you say otherwise.
+//Triggers first: they are the most sensitive to timing.
+#define BETWEENER_SCHED_PRIORITY_TRIGGERS 3
+#define BETWEENER_SCHED_PRIORITY_CVS 2
+#define BETWEENER_SCHED_PRIORITY_MIDI 1
+#define BETWEENER_SCHED_PRIORITY_KNOBS 0
+
+
+class BetweenerScheduler
+{
+    public:
+
+    BetweenerScheduler(void);
+
+    //Adds a task and returns its number (used by the functions below),
+    //or -1 if the scheduler is full.  The name is only used by
+    //printStats().  A new task is due straight away.
+    int addTask(void (*function)(void *), void *arg, uint32_t periodMicros,
+                uint32_t deadlineMicros = 0, int priority = 0, const char *name = "");
+    void removeTask(int task);
+    void setPeriod(int task, uint32_t periodMicros);
+    void setEnabled(int task, bool enabled);  //a disabled task is skipped
+
+    //the ready-made tasks (for the parts of the library that are built,
+    //see BetweenerConfig.h)
+#if BETWEENER_USE_TRIGGERS
+    int addReadTriggers(Betweener &b, uint32_t periodMicros = 1000, int priority = BETWEENER_SCHED_PRIORITY_TRIGGERS);
+#endif
+#if BETWEENER_USE_ANALOG_INPUTS
+    int addReadCVs(Betweener &b, uint32_t periodMicros = 500, int priority = BETWEENER_SCHED_PRIORITY_CVS);
+    int addReadKnobs(Betweener &b, uint32_t periodMicros = 10000, int priority = BETWEENER_SCHED_PRIORITY_KNOBS);
+#endif
+#if BETWEENER_USE_USB_MIDI
+    int addReadUsbMIDI(Betweener &b, uint32_t periodMicros = 0, int priority = BETWEENER_SCHED_PRIORITY_MIDI);
+#endif
+
+    //Runs every task that is due, each at most once, most urgent first.
+    //Call it from loop().  Returns how many tasks ran.
+    int run(void);
+
+    //how long until the next task is due (0 if one is due now)
+    uint32_t microsUntilNext(void);
+
+    //The accounting, for each task, since it was added or resetStats()
+    uint32_t runs(int task);
+    uint32_t deadlineMisses(int task);  //finished after its deadline
+    uint32_t skippedPeriods(int task);  //periods dropped because it fell a whole period behind
+    uint32_t maxCycles(int task);       //the longest one run took, in processor cycles
+    float cpuShare(int task);           //the fraction of the time spent in it, 0 to 1
+    float idleShare(void);              //the fraction spent outside every task
+    void resetStats(void);
+    void printStats(Print &out = Serial);
+
+
+    private:
+
+    struct Task {
+        void (*function)(void *);  //NULL = this slot is free
+        void *arg;
+        const char *name;
+        uint32_t period;
+        uint32_t deadline;
+        int8_t priority;
+        bool enabled;
+        uint32_t release;  //micros() when it is next due
+        uint32_t runs;
+        uint32_t misses;
+        uint32_t skipped;
+        uint32_t maxCycles;
+        uint64_t busyCycles;
+    };
+
+    bool validTask(int task);
+    bool due(const Task &t, uint32_t now);
+    void runTask(Task &t);
+
+#if BETWEENER_USE_TRIGGERS
+    static void readTriggersTask(void *b);
+#endif
+#if BETWEENER_USE_ANALOG_INPUTS
+    static void readCVsTask(void *b);
+    static void readKnobsTask(void *b);
+#endif
+#if BETWEENER_USE_USB_MIDI
+    static void readUsbMIDITask(void *b);
+#endif
+
+    Task tasks_[BETWEENER_SCHED_TASKS];
+
+    //time since the first addTask() or run(), or since resetStats(),
+    //kept in 64 bits so it never wraps
+    void countTime(void);
+    uint64_t elapsed_;
+    uint32_t statsLast_;
+    bool statsStarted_;  //false until the first countTime()
+};
+
+
+#endif /* BetweenerScheduler_h */
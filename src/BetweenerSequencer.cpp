@@ -0,0 +1,334 @@
+//
+//  BetweenerSequencer.cpp
+//
+//  Copyright (c) 2018 Kathryn Schaffer
+
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+//  BetweenerSequencer.cpp detailed description:
+//
+//  Implementation of BetweenerSequencer.  See BetweenerSequencer.h for how to
+//  use it.  The functions near the top are called from your sketch; the ones
+//  near the bottom (clockRose, clockFell and the ISRs) run inside interrupts
+//  and are kept short on purpose.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "BetweenerSequencer.h"
+
+BetweenerSequencer * BetweenerSequencer::active_ = NULL;
+
+BetweenerSequencer::BetweenerSequencer(void){
+    //a blank pattern: 16 steps, all notes at 0V, no gates.  Track 1 plays
+    //pitch on out 1 and gate on out 2 so something happens out of the box.
+    for (int t = 0; t < BETWEENER_SEQ_TRACKS; t++){
+        for (int s = 0; s < BETWEENER_SEQ_MAX_STEPS; s++){
+            steps_[t][s] = packStep(0, false, 0);
+        }
+        length_[t] = 16;
+        division_[t] = 1;
+        pitchOut_[t] = 0;
+        gateOut_[t] = 0;
+        cvOut_[t] = 0;
+        position_[t] = -1;
+        divCount_[t] = 0;
+        gateHigh_[t] = false;
+    }
+    pitchOut_[0] = 1;
+    gateOut_[0] = 2;
+    resetPending_ = false;
+    clockTrigger_ = 0;
+    resetTrigger_ = 0;
+    internalPhase_ = true;
+}
+
+
+uint16_t BetweenerSequencer::noteToCV(int note){
+    return BetweenerMath::noteToCV(note);
+}
+
+
+bool BetweenerSequencer::validTrack(int track){
+    if (track < 1 || track > BETWEENER_SEQ_TRACKS){
+        BETWEENER_LOG(BETWEENER_LOG_BAD_SEQ_TRACK, track);
+        return false;
+    }
+    return true;
+}
+
+
+bool BetweenerSequencer::validStep(int track, int step){
+    if (!validTrack(track)) return false;
+    if (step < 0 || step >= BETWEENER_SEQ_MAX_STEPS){
+        BETWEENER_LOG(BETWEENER_LOG_BAD_SEQ_STEP, step);
+        return false;
+    }
+    return true;
+}
+
+
+void BetweenerSequencer::setTrackOutputs(int track, int pitchOut, int gateOut, int cvOut){
+    if (!validTrack(track)) return;
+    pitchOut_[track - 1] = (pitchOut >= 1 && pitchOut <= 4) ? pitchOut : 0;
+    gateOut_[track - 1] = (gateOut >= 1 && gateOut <= 4) ? gateOut : 0;
+    cvOut_[track - 1] = (cvOut >= 1 && cvOut <= 4) ? cvOut : 0;
+}
+
+
+void BetweenerSequencer::setLength(int track, int steps){
+    if (!validTrack(track)) return;
+    length_[track - 1] = constrain(steps, 1, BETWEENER_SEQ_MAX_STEPS);
+}
+
+
+void BetweenerSequencer::setDivision(int track, int clocksPerStep){
+    if (!validTrack(track)) return;
+    division_[track - 1] = constrain(clocksPerStep, 1, 255);
+}
+
+
+void BetweenerSequencer::setStep(int track, int step, int note, bool gate, int cv){
+    if (!validStep(track, step)) return;
+    note = constrain(note, 0, BETWEENER_SEQ_MAX_NOTE);
+    cv = constrain(cv, 0, 4095);
+    //one 32-bit store: the clock interrupt sees either the old or the new step
+    steps_[track - 1][step] = packStep(note, gate, cv);
+}
+
+
+void BetweenerSequencer::setNote(int track, int step, int note){
+    setStep(track, step, note, getGate(track, step), getCV(track, step));
+}
+
+
+void BetweenerSequencer::setGate(int track, int step, bool gate){
+    setStep(track, step, getNote(track, step), gate, getCV(track, step));
+}
+
+
+void BetweenerSequencer::setCV(int track, int step, int cv){
+    setStep(track, step, getNote(track, step), getGate(track, step), cv);
+}
+
+
+int BetweenerSequencer::getNote(int track, int step){
+    if (!validStep(track, step)) return -1;
+    return steps_[track - 1][step] >> 25;
+}
+
+
+bool BetweenerSequencer::getGate(int track, int step){
+    if (!validStep(track, step)) return false;
+    return (steps_[track - 1][step] >> 24) & 1;
+}
+
+
+int BetweenerSequencer::getCV(int track, int step){
+    if (!validStep(track, step)) return -1;
+    return (steps_[track - 1][step] >> 12) & 0xFFF;
+}
+
+
+int BetweenerSequencer::currentStep(int track){
+    if (!validTrack(track)) return -1;
+    return position_[track - 1];
+}
+
+
+void BetweenerSequencer::attachClock(int trigger, bool isReset){
+    if (trigger < 1 || trigger > 4){
+        DEBUG_PRINTLN("you are trying to use a nonexistent trigger!");
+        return;
+    }
+    active_ = this;
+    const uint8_t pin = BETWEENER_BOARD.triggerPins[trigger - 1];
+
+    //the DACs get written from this pin's interrupt
+    Betweener::shareDACWithPin(pin);
+
+    //we want both edges: the rising one starts a step, the falling one
+    //ends its gate.  Note the trigger inputs are inverted by the hardware,
+    //so clockEdge() reads the pin to tell which edge it was.
+    void (*isr)(void) = clockISR1;
+    if (trigger == 2) isr = clockISR2;
+    if (trigger == 3) isr = clockISR3;
+    if (trigger == 4) isr = clockISR4;
+    attachInterrupt(pin, isr, isReset ? FALLING : CHANGE);
+}
+
+
+void BetweenerSequencer::clockFromTrigger(int trigger){
+    stop();
+    clockTrigger_ = trigger;
+    attachClock(trigger, false);
+}
+
+
+void BetweenerSequencer::resetFromTrigger(int trigger){
+    if (resetTrigger_ >= 1 && resetTrigger_ <= 4) detachInterrupt(BETWEENER_BOARD.triggerPins[resetTrigger_ - 1]);
+    resetTrigger_ = trigger;
+    attachClock(trigger, true);
+}
+
+
+bool BetweenerSequencer::clockInternal(float bpm, int stepsPerBeat){
+    stop();
+    active_ = this;
+    Betweener::shareDACWithTimers();
+    if (bpm <= 0 || stepsPerBeat < 1){
+        DEBUG_PRINTLN("the sequencer needs a positive tempo!");
+        return false;
+    }
+    //the timer ticks twice per step: once to start it, once to end the gate
+    const float halfStepMicros = 60000000.0 / (bpm * stepsPerBeat) / 2.0;
+    internalPhase_ = true;
+    if (!timer_.begin(internalISR, halfStepMicros)){
+        DEBUG_PRINTLN("the sequencer: all the hardware timers (IntervalTimers) are in use!");
+        return false;
+    }
+    return true;
+}
+
+
+void BetweenerSequencer::stop(void){
+    timer_.end();
+    if (clockTrigger_ >= 1 && clockTrigger_ <= 4){
+        detachInterrupt(BETWEENER_BOARD.triggerPins[clockTrigger_ - 1]);
+    }
+    clockTrigger_ = 0;
+    clockFell();  //make sure no gate is left hanging high
+}
+
+
+void BetweenerSequencer::reset(void){
+    resetPending_ = true;
+}
+
+
+bool BetweenerSequencer::handleSysEx(const uint8_t *data, unsigned int length){
+    //skip the F0 / F7 framing if it is there
+    if (length > 0 && data[0] == 0xF0){ data++; length--; }
+    if (length > 0 && data[length - 1] == 0xF7){ length--; }
+
+    if (length < 3 || data[0] != BETWEENER_SYSEX_ID || data[1] != BETWEENER_SYSEX_SEQUENCER){
+        return false;
+    }
+    const uint8_t command = data[2];
+    const uint8_t *args = data + 3;
+    const unsigned int nargs = length - 3;
+
+    switch (command){
+        case 0x01:
+            if (nargs != 6) return false;
+            setStep(args[0], args[1], args[2], args[3] != 0, (args[4] << 7) | args[5]);
+            return true;
+        case 0x02:
+            if (nargs != 2) return false;
+            setLength(args[0], args[1]);
+            return true;
+        case 0x03:
+            if (nargs != 2) return false;
+            setDivision(args[0], args[1]);
+            return true;
+        default:
+            return false;
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////
+//Everything below here runs inside interrupts.
+
+void BetweenerSequencer::clockRose(void){
+    const bool doReset = resetPending_;
+    resetPending_ = false;
+
+    for (int t = 0; t < BETWEENER_SEQ_TRACKS; t++){
+        if (doReset){
+            position_[t] = -1;
+            divCount_[t] = 0;
+        }
+        //only every division-th clock moves this track on
+        if (divCount_[t] != 0){
+            divCount_[t] = (divCount_[t] + 1 < division_[t]) ? divCount_[t] + 1 : 0;
+            continue;
+        }
+        divCount_[t] = (division_[t] > 1) ? 1 : 0;
+
+        int pos = position_[t] + 1;
+        if (pos >= length_[t]) pos = 0;
+        position_[t] = pos;
+
+        //everything was precomputed when the step was edited, so this is
+        //just unpacking bits and writing DACs.  Pitch and CV go first so
+        //the gate rises on a settled voltage.
+        const uint32_t step = steps_[t][pos];
+        if (pitchOut_[t]) Betweener::writeCVOut(pitchOut_[t], step & 0xFFF);
+        if (cvOut_[t]) Betweener::writeCVOut(cvOut_[t], (step >> 12) & 0xFFF);
+        if (gateOut_[t] && ((step >> 24) & 1)){
+            Betweener::writeCVOut(gateOut_[t], 4095);
+            gateHigh_[t] = true;
+        }
+    }
+}
+
+
+void BetweenerSequencer::clockFell(void){
+    for (int t = 0; t < BETWEENER_SEQ_TRACKS; t++){
+        if (gateHigh_[t]){
+            Betweener::writeCVOut(gateOut_[t], 0);
+            gateHigh_[t] = false;
+        }
+    }
+}
+
+
+void BetweenerSequencer::clockEdge(int trigger){
+    BetweenerSequencer *self = active_;
+    if (!self) return;
+
+    if (trigger == self->resetTrigger_){
+        self->resetPending_ = true;
+        return;
+    }
+    //the hardware inverts the trigger inputs: a LOW pin means the trigger is high
+    if (digitalRead(BETWEENER_BOARD.triggerPins[trigger - 1]) == LOW){
+        self->clockRose();
+    }else{
+        self->clockFell();
+    }
+}
+
+
+void BetweenerSequencer::clockISR1(void){ clockEdge(1); }
+void BetweenerSequencer::clockISR2(void){ clockEdge(2); }
+void BetweenerSequencer::clockISR3(void){ clockEdge(3); }
+void BetweenerSequencer::clockISR4(void){ clockEdge(4); }
+
+
+void BetweenerSequencer::internalISR(void){
+    BetweenerSequencer *self = active_;
+    if (!self) return;
+    if (self->internalPhase_){
+        self->clockRose();
+    }else{
+        self->clockFell();
+    }
+    self->internalPhase_ = !self->internalPhase_;
+}
@@ -0,0 +1,168 @@
+//
+//  BetweenerSequencer.h
+//
+//  Copyright (c) 2018 Kathryn Schaffer
+
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////
+//  BetweenerSequencer.h detailed description:
+//
+//  This file defines BetweenerSequencer, a step sequencer that runs "in the
+//  background", inside interrupts, instead of in loop().  That means a step
+//  lands on the CV outputs a few microseconds after its clock edge, no
+//  matter how busy the rest of your sketch is.
+//
+//  The sequencer has up to 4 tracks of up to 64 steps.  Each step has:
+//      - a note (0-60, five octaves at 1V/octave from 0V)
+//      - a gate (on or off)
+//      - a CV value (0-4095, sent straight to a DAC)
+//  Each track can send its pitch, gate and CV to any of the four CV outs
+//  (or to none), so you can have e.g. one pitch+gate track and two
+//  modulation tracks.
+//
+//  The clock comes from a trigger input (each rising edge is a step; the
+//  gate follows the clock pulse and goes low when the clock does) or from
+//  an internal timer at a tempo you choose.  Another trigger input can be
+//  used as reset.
+//
+//  Editing is safe while playing.  The DAC numbers for a step are worked
+//  out when you edit it and stored as a single 32-bit word, which the
+//  processor writes in one go, so the interrupt can never see a step that
+//  is half old and half new.
+//
+//  Patterns can also be edited over USB with SysEx; see handleSysEx().
+//
+//  Example:
+//      Betweener b;
+//      BetweenerSequencer seq;
+//      void setup(){
+//          b.begin();
+//          seq.setTrackOutputs(1, 1, 2, 0);  //track 1: pitch on out 1, gate on out 2
+//          seq.setStep(1, 0, 24, true, 0);   //step 0: note 24 (2V), gate on
+//          ...
+//          seq.clockFromTrigger(1);          //advance on trigger input 1
+//          seq.resetFromTrigger(2);          //reset on trigger input 2
+//      }
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef BetweenerSequencer_h
+#define BetweenerSequencer_h
+
+#include <Arduino.h>
+#include "Betweener.h"
+
+#define BETWEENER_SEQ_TRACKS 4
+#define BETWEENER_SEQ_MAX_STEPS 64
+
+//SysEx messages for the sequencer start with these bytes (after the F0).
+//0x7D is the manufacturer ID reserved for non-commercial use.
+#define BETWEENER_SYSEX_ID 0x7D
+#define BETWEENER_SYSEX_SEQUENCER 0x42
+
+
+class BetweenerSequencer
+{
+    public:
+
+    BetweenerSequencer(void);
+
+    //Routing.  Outputs are 1-4, 0 means "not used".  Tracks are 1-4.
+    void setTrackOutputs(int track, int pitchOut, int gateOut, int cvOut);
+    void setLength(int track, int steps);        //1-64
+    void setDivision(int track, int clocksPerStep);  //1 = every clock
+
+    //Editing.  Steps are numbered from 0.  All of these are safe to call
+    //while the sequencer is playing.
+    void setStep(int track, int step, int note, bool gate, int cv);
+    void setNote(int track, int step, int note);
+    void setGate(int track, int step, bool gate);
+    void setCV(int track, int step, int cv);
+    int getNote(int track, int step);
+    bool getGate(int track, int step);
+    int getCV(int track, int step);
+
+    //Clocking.  Triggers are 1-4.
+    void clockFromTrigger(int trigger);
+    void resetFromTrigger(int trigger);
+    bool clockInternal(float bpm, int stepsPerBeat = 4);  //false if no hardware timer was free
+    void stop(void);
+    void reset(void);  //the next clock plays step 0 on every track
+
+    int currentStep(int track);  //the step playing now, or -1 before the first clock
+
+    //Apply a SysEx message (as handed over by usbMIDI's SysEx handler,
+    //with or without the F0 and F7).  Returns false if the message was not
+    //for the sequencer or was malformed.  Message bodies, all 7-bit:
+    //  7D 42 01 track step note gate cvHigh cvLow   set one step
+    //  7D 42 02 track length                        set track length
+    //  7D 42 03 track division                      set clock division
+    //cv is 12 bits split as cvHigh = top 5 bits, cvLow = bottom 7 bits.
+    bool handleSysEx(const uint8_t *data, unsigned int length);
+
+    //the DAC number for a note, 1V/octave
+    static uint16_t noteToCV(int note);
+
+
+    private:
+
+    //one step, packed so it can be stored in a single write (the layout
+    //is in BetweenerMath.h)
+    static inline uint32_t packStep(int note, bool gate, int cv){
+        return BetweenerMath::packStep(note, gate, cv);
+    };
+
+    bool validTrack(int track);
+    bool validStep(int track, int step);
+
+    void clockRose(void);
+    void clockFell(void);
+    void attachClock(int trigger, bool isReset);
+
+    static void clockISR1(void);
+    static void clockISR2(void);
+    static void clockISR3(void);
+    static void clockISR4(void);
+    static void clockEdge(int trigger);
+    static void internalISR(void);
+
+    static BetweenerSequencer *active_;
+
+    volatile uint32_t steps_[BETWEENER_SEQ_TRACKS][BETWEENER_SEQ_MAX_STEPS];
+    volatile uint8_t length_[BETWEENER_SEQ_TRACKS];
+    volatile uint8_t division_[BETWEENER_SEQ_TRACKS];
+    volatile uint8_t pitchOut_[BETWEENER_SEQ_TRACKS];
+    volatile uint8_t gateOut_[BETWEENER_SEQ_TRACKS];
+    volatile uint8_t cvOut_[BETWEENER_SEQ_TRACKS];
+
+    //playback state, only touched from the clock interrupt (and reset)
+    volatile int8_t position_[BETWEENER_SEQ_TRACKS];
+    volatile uint8_t divCount_[BETWEENER_SEQ_TRACKS];
+    volatile bool gateHigh_[BETWEENER_SEQ_TRACKS];
+    volatile bool resetPending_;
+
+    int clockTrigger_;  //0 = none
+    int resetTrigger_;  //0 = none
+    IntervalTimer timer_;
+    volatile bool internalPhase_;  //true: the next internal tick is a rising edge
+};
+
+
+#endif /* BetweenerSequencer_h */
@@ -0,0 +1,135 @@
+//
+//  BetweenerTelemetry.cpp
+//
+//  Copyright (c) 2018 Kathryn Schaffer
+
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+//  BetweenerTelemetry.cpp detailed description:
+//
+//  Implementation of BetweenerTelemetry.  See BetweenerTelemetry.h for the
+//  frame layout and how to use it.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "BetweenerTelemetry.h"
+
+BetweenerTelemetry * BetweenerTelemetry::active_ = NULL;
+
+
+//little helpers to lay numbers into the frame byte by byte, lowest byte
+//first, so the layout does not depend on how the compiler packs structs
+static inline uint8_t *put16(uint8_t *p, uint16_t v){
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+    return p + 2;
+}
+
+static inline uint8_t *put32(uint8_t *p, uint32_t v){
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+    return p + 4;
+}
+
+
+bool BetweenerTelemetry::begin(float framesPerSecond){
+    active_ = this;
+    queueIn_ = 0;
+    queueOut_ = 0;
+    return setRate(framesPerSecond);
+}
+
+
+void BetweenerTelemetry::end(void){
+    timer_.end();
+}
+
+
+bool BetweenerTelemetry::setRate(float framesPerSecond){
+    if (framesPerSecond <= 0){
+        DEBUG_PRINTLN("telemetry needs a positive frame rate!");
+        return false;
+    }
+    if (!timer_.begin(timerISR, (float)(1000000.0 / framesPerSecond))){
+        DEBUG_PRINTLN("telemetry: all the hardware timers (IntervalTimers) are in use!");
+        return false;
+    }
+    return true;
+}
+
+
+void BetweenerTelemetry::capture(void){
+    const uint16_t seq = sequence_++;
+
+    //no room: drop this one, but the sequence number still moves on so
+    //the computer can see the gap
+    if (queueIn_ - queueOut_ >= BETWEENER_TELEMETRY_QUEUE){
+        framesDropped_++;
+        return;
+    }
+
+    uint8_t *frame = queue_[queueIn_ % BETWEENER_TELEMETRY_QUEUE];
+    uint8_t *p = frame;
+    *p++ = BETWEENER_TELEMETRY_SYNC1;
+    *p++ = BETWEENER_TELEMETRY_SYNC2;
+    *p++ = BETWEENER_TELEMETRY_FRAME_TYPE;
+    *p++ = BETWEENER_TELEMETRY_FRAME_SIZE - 6;
+    p = put16(p, seq);
+    p = put32(p, micros());
+
+    //one consistent copy of the inputs, even if the sketch is in the
+    //middle of reading new ones.  The values go in as they are
+    //(-1, "never read", shows up as 0xFFFF).
+    Betweener::InputSnapshot in;
+    b_.getInputs(in);
+    for (int i = 0; i < 4; i++){
+        p = put16(p, in.cv[i]);
+    }
+    for (int i = 0; i < 4; i++){
+        p = put16(p, in.knob[i]);
+    }
+    *p++ = in.triggers;
+
+    for (int i = 1; i <= 4; i++){
+        p = put16(p, Betweener::currentCVOut(i));
+    }
+
+    //Fletcher-16 checksum over everything after the sync bytes
+    p = put16(p, BetweenerMath::fletcher16(frame + 2, p));
+
+    queueIn_ = queueIn_ + 1;
+}
+
+
+void BetweenerTelemetry::update(void){
+    //send whole frames only, and only as many as fit without blocking
+    while (queueOut_ != queueIn_){
+        if (port_.availableForWrite() < BETWEENER_TELEMETRY_FRAME_SIZE) break;
+        port_.write(queue_[queueOut_ % BETWEENER_TELEMETRY_QUEUE], BETWEENER_TELEMETRY_FRAME_SIZE);
+        queueOut_ = queueOut_ + 1;
+        framesSent_++;
+    }
+}
+
+
+void BetweenerTelemetry::timerISR(void){
+    if (active_) active_->capture();
+}
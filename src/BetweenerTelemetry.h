@@ -0,0 +1,118 @@
+//
+//  BetweenerTelemetry.h
+//
+//  Copyright (c) 2018 Kathryn Schaffer
+
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////
+//  BetweenerTelemetry.h detailed description:
+//
+//  This file defines BetweenerTelemetry, which streams everything the
+//  Betweener sees and does to a computer over USB serial, in a compact
+//  binary form, so you can watch it like an oscilloscope.
+//
+//  Printing numbers with Serial.println is slow (each digit has to be
+//  worked out) and it can stall your sketch.  Instead, a timer takes a
+//  "snapshot" at a steady rate you choose (from a few Hz to several kHz)
+//  and copies the numbers as they are into a small queue.  update(), called
+//  from loop(), sends the queue only when USB has room, and simply drops
+//  snapshots (and counts them) rather than ever waiting.
+//
+//  Every frame is 37 bytes, little-endian:
+//      offset  size  contents
+//       0      2     sync bytes 0xA5 0x5A
+//       2      1     frame type (BETWEENER_TELEMETRY_FRAME_TYPE)
+//       3      1     payload length (31, from offset 4 to the checksum)
+//       4      2     sequence number (counts up by one per snapshot taken,
+//                    so a gap on the computer means frames were dropped)
+//       6      4     timestamp, micros()
+//      10     16     CV in 1-4 and knobs 1-4, as last read by the library
+//                    (0xFFFF if never read)
+//      26      1     trigger inputs, bit 0 = trigger 1 ... (1 = high)
+//      27      8     CV out 1-4, the DAC values last written
+//      35      2     Fletcher-16 checksum of bytes 2 to 34
+//
+//  The inputs are copied with Betweener::getInputs(), so each frame shows
+//  one consistent set of values as of the last readCVs()/readKnobs()/
+//  readTriggers() call; it does not start any ADC conversions itself.
+//
+//  A Python program to record and decode the stream is in
+//  extras/telemetry/betweener_telemetry.py.
+//
+//  Example:
+//      Betweener b;
+//      BetweenerTelemetry telemetry(b);
+//      void setup(){ b.begin(); telemetry.begin(1000); }   //1 kHz
+//      void loop(){ b.readAllInputs(); ...; telemetry.update(); }
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef BetweenerTelemetry_h
+#define BetweenerTelemetry_h
+
+#include <Arduino.h>
+#include "Betweener.h"
+
+#define BETWEENER_TELEMETRY_SYNC1 0xA5
+#define BETWEENER_TELEMETRY_SYNC2 0x5A
+#define BETWEENER_TELEMETRY_FRAME_TYPE 0x01
+#define BETWEENER_TELEMETRY_FRAME_SIZE 37
+#define BETWEENER_TELEMETRY_QUEUE 32  //frames waiting for USB; a power of two
+
+
+class BetweenerTelemetry
+{
+    public:
+
+    BetweenerTelemetry(Betweener &b, Stream &port = Serial) : b_(b), port_(port) {}
+
+    //begin and setRate return false if no hardware timer was free
+    bool begin(float framesPerSecond);
+    void end(void);
+    bool setRate(float framesPerSecond);
+
+    //sends whatever is queued, as far as the USB buffer allows.  Never waits.
+    void update(void);
+
+    uint32_t framesSent(void){ return framesSent_; };
+    uint32_t framesDropped(void){ return framesDropped_; };
+
+
+    private:
+
+    void capture(void);
+    static void timerISR(void);
+    static BetweenerTelemetry *active_;
+
+    Betweener &b_;
+    Stream &port_;
+    IntervalTimer timer_;
+
+    uint8_t queue_[BETWEENER_TELEMETRY_QUEUE][BETWEENER_TELEMETRY_FRAME_SIZE];
+    volatile uint32_t queueIn_ = 0;   //frames ever captured into the queue
+    volatile uint32_t queueOut_ = 0;  //frames ever sent from it
+    uint16_t sequence_ = 0;
+
+    volatile uint32_t framesSent_ = 0;
+    volatile uint32_t framesDropped_ = 0;
+};
+
+
+#endif /* BetweenerTelemetry_h */